@@ -0,0 +1,293 @@
+#include <omp.h>
+#include <iostream>
+#include <fstream>
+#include <numeric>
+#include <iterator>
+#include <cine/cmd_line.h>
+#include <cine/archive.hpp>
+#include <cine/any_ann.hpp>
+
+
+using namespace archive;
+using namespace cine2;
+
+
+// Per-generation statistics over one or many run directories.
+//
+// One row per run and generation:
+//   run, G, N,
+//   fitness: mean, sd, q05, q25, q50, q75, q95
+//   foraged, handled: means
+//   forager, klept, conditional: strategy fractions (sign of the strategy output
+//     on the observed input grid, at zero input for obligate strategies)
+//   parents: distinct ancestors, turnover: 1 - parents / N
+//   clades: surviving lineages of the individuals of the first recorded generation
+//   w<k>.mean, w<k>.sd: moments of ANN weight k
+// Missing archives (e.g. output.mode=summary) yield NA.
+
+
+namespace {
+
+  const double NA = std::numeric_limits<double>::quiet_NaN();
+
+
+  struct Run
+  {
+    fs::path dir;
+    Param param;
+    std::vector<std::vector<double>> input;   // per generation: min, max, mean, sd, mad per input
+  };
+
+
+  template <typename T>
+  std::vector<T> load(const compressed_mem& cm)
+  {
+    std::vector<T> res((cm.un * cm.usize) / sizeof(T));
+    uncompress(res.data(), cm);
+    return res;
+  }
+
+
+  double quantile(std::vector<float>& x, double q)
+  {
+    auto nth = x.begin() + static_cast<size_t>(q * (x.size() - 1) + 0.5);
+    std::nth_element(x.begin(), nth, x.end());
+    return *nth;
+  }
+
+
+  // {forager, klept, conditional} fractions
+  std::array<double, 3> strategies(const any_ann& ann, const Param::ind_param& iparam, const std::vector<double>& input)
+  {
+    const int N = ann.N();
+    const int I = ann.input_size();
+    const int O = ann.output_size();
+    if (O < 2) return { NA, NA, NA };
+    std::vector<float> grid;
+    if (iparam.obligate) {
+      grid.assign(I, 0.f);
+    }
+    else {
+      int P = 1;
+      for (int j = 0; j < I; ++j) P *= 3;
+      for (int p = 0; p < P; ++p) {
+        for (int j = 0, q = p; j < I; ++j, q /= 3) {
+          const double val = (q % 3 == 0) ? input[5 * j] : (q % 3 == 1) ? input[5 * j + 2] : input[5 * j + 1];
+          grid.push_back(static_cast<float>(iparam.input_mask[j] * val));
+        }
+      }
+    }
+    const int P = static_cast<int>(grid.size()) / I;
+    std::vector<float> out(static_cast<size_t>(P) * O);
+    std::array<int, 3> counts = { 0, 0, 0 };
+    for (int i = 0; i < N; ++i) {
+      ann.evaluate(i, grid.data(), P, out.data());
+      int pos = 0;
+      for (int p = 0; p < P; ++p) pos += (out[p * O + 1] >= 0.f) ? 1 : 0;
+      ++counts[(iparam.forage || pos == P) ? 0 : (pos == 0) ? 1 : 2];
+    }
+    return { double(counts[0]) / N, double(counts[1]) / N, double(counts[2]) / N };
+  }
+
+
+  std::vector<fs::path> run_dirs(const cmd::cmd_line_parser& clp)
+  {
+    std::vector<fs::path> dirs;
+    fs::path dir;
+    if (clp.optional("dir", dir)) dirs.push_back(dir);
+    fs::path sweep;
+    if (clp.optional("sweep", sweep)) {
+      for (const auto& entry : fs::directory_iterator(sweep)) {
+        if (entry.is_directory() && fs::exists(entry.path() / "config.ini")) dirs.push_back(entry.path());
+      }
+      std::sort(dirs.begin(), dirs.end());
+    }
+    if (dirs.empty()) throw cmd::parse_error("dir or sweep required");
+    return dirs;
+  }
+
+
+  Run open_run(const fs::path& dir)
+  {
+    auto clp = config_file_parser((dir / "config.ini").string());
+    Run run{ dir, parse_parameter(clp), {} };
+    std::ifstream is(dir / "agents_input.bin", std::ios::in | std::ios::binary);
+    std::vector<double> rec(15);
+    while (is.read((char*)rec.data(), rec.size() * sizeof(double))) run.input.push_back(rec);
+    return run;
+  }
+
+
+  // generation statistics of one run, generations in parallel
+  std::vector<std::vector<double>> analyse_run(const Run& run)
+  {
+    const int W = make_any_ann(run.param.agents.L, 1, run.param.agents.ann.c_str())->state_size();
+    const auto& dir = run.dir;
+    auto opt_arch = [&](const char* name) { return fs::exists(dir / name) ? std::make_unique<iarch>(dir / name) : nullptr; };
+    auto ia_fit = opt_arch("agents_fit.arc");
+    auto ia_anc = opt_arch("agents_anc.arc");
+    auto ia_foa = opt_arch("agents_foa.arc");
+    auto ia_han = opt_arch("agents_han.arc");
+    auto ia_ann = opt_arch("agents_ann.arc");
+    // recorded generations: per-agent archives, else the summary archive, else the parameters
+    auto ia_dst = opt_arch("agents_dst.arc");
+    const int G = static_cast<int>(ia_fit ? ia_fit->size() : ia_dst ? ia_dst->size() : run.param.G);
+    auto has = [&](const std::unique_ptr<iarch>& ia, int g) { return ia && g < static_cast<int>(ia->size()); };
+
+    // lineages need the generations in order: cheap serial pass over the ancestors
+    std::vector<double> parents(G, NA), clades(G, NA);
+    if (ia_anc) {
+      std::vector<int> founder, prev_founder;
+      std::vector<char> seen;
+      for (int g = 0; g < G && has(ia_anc, g); ++g) {
+        const auto anc = load<int>(ia_anc->extract(g));
+        const int N = static_cast<int>(anc.size());
+        founder.resize(N);
+        for (int i = 0; i < N; ++i) {
+          founder[i] = prev_founder.empty() ? i : prev_founder[anc[i]];
+        }
+        int np = 0, nc = 0;
+        seen.assign(N + 1, 0);
+        for (int i = 0; i < N; ++i) if (!(seen[anc[i]] & 1)) { seen[anc[i]] |= 1; ++np; }
+        for (int i = 0; i < N; ++i) if (!(seen[founder[i]] & 2)) { seen[founder[i]] |= 2; ++nc; }
+        parents[g] = np;
+        clades[g] = nc;
+        prev_founder.swap(founder);
+      }
+    }
+
+    std::vector<std::vector<double>> rows(G);
+#   pragma omp parallel
+    {
+      std::unique_ptr<any_ann> ann;
+#     pragma omp for schedule(dynamic)
+      for (int g = 0; g < G; ++g) {
+        std::vector<float> fit, foa, han, state;
+        std::unique_ptr<compressed_mem> cm_ann;
+#       pragma omp critical(analyse_extract)
+        {
+          if (has(ia_fit, g)) fit = load<float>(ia_fit->extract(g));
+          if (has(ia_foa, g)) foa = load<float>(ia_foa->extract(g));
+          if (has(ia_han, g)) han = load<float>(ia_han->extract(g));
+          if (has(ia_ann, g)) cm_ann.reset(new compressed_mem(ia_ann->extract(g)));
+        }
+        const int N = fit.empty() ? run.param.agents.N : static_cast<int>(fit.size());
+        auto& row = rows[g];
+        row = { double(g), double(N) };
+        if (fit.empty()) {
+          row.insert(row.end(), 7, NA);
+        }
+        else {
+          double sum = 0.0, sum2 = 0.0;
+          for (float f : fit) { sum += f; sum2 += double(f) * f; }
+          const double mean = sum / N;
+          row.push_back(mean);
+          row.push_back(std::sqrt(std::max(0.0, sum2 / N - mean * mean)));
+          for (double q : { 0.05, 0.25, 0.5, 0.75, 0.95 }) row.push_back(quantile(fit, q));
+        }
+        row.push_back(foa.empty() ? NA : std::accumulate(foa.begin(), foa.end(), 0.0) / N);
+        row.push_back(han.empty() ? NA : std::accumulate(han.begin(), han.end(), 0.0) / N);
+
+        std::array<double, 3> str = { NA, NA, NA };
+        std::vector<double> wsum(W, NA), wsum2(W, NA);
+        if (cm_ann && static_cast<int>(cm_ann->usize) == W * sizeof(float)) {
+          if (!ann || ann->N() != N) ann = make_any_ann(run.param.agents.L, N, run.param.agents.ann.c_str());
+          uncompress(ann->data(), *cm_ann, ann->stride() * sizeof(float));
+          if (g < static_cast<int>(run.input.size())) str = strategies(*ann, run.param.agents, run.input[g]);
+          wsum.assign(W, 0.0);
+          wsum2.assign(W, 0.0);
+          for (int i = 0; i < N; ++i) {
+            const float* w = (*ann)[i];
+            for (int k = 0; k < W; ++k) { wsum[k] += w[k]; wsum2[k] += double(w[k]) * w[k]; }
+          }
+          for (int k = 0; k < W; ++k) {
+            wsum[k] /= N;
+            wsum2[k] = std::sqrt(std::max(0.0, wsum2[k] / N - wsum[k] * wsum[k]));
+          }
+        }
+        row.insert(row.end(), str.begin(), str.end());
+        row.push_back(parents[g]);
+        row.push_back(std::isnan(parents[g]) ? NA : 1.0 - parents[g] / N);
+        row.push_back(clades[g]);
+        for (int k = 0; k < W; ++k) { row.push_back(wsum[k]); row.push_back(wsum2[k]); }
+      }
+    }
+    return rows;
+  }
+
+}
+
+
+int main(int argc, const char** argv)
+{
+  try {
+    cmd::cmd_line_parser clp(argc, argv);
+    const auto dirs = run_dirs(clp);
+    const auto out = clp.optional_val("out", fs::path("stats.csv"));
+    const int threads = clp.optional_val("omp_threads", omp_get_max_threads());
+    auto unrecognized = clp.unrecognized();
+    if (!unrecognized.empty()) throw cmd::parse_error("unknown argument '" + unrecognized.front() + "'");
+
+    std::vector<Run> runs;
+    for (const auto& dir : dirs) runs.push_back(open_run(dir));
+    omp_set_num_threads(threads);   // parse_parameter sets the run's omp_threads
+
+    // weight columns: widest ANN of all runs
+    int W = 0;
+    for (const auto& run : runs) {
+      W = std::max(W, make_any_ann(run.param.agents.L, 1, run.param.agents.ann.c_str())->state_size());
+    }
+    std::vector<std::string> cols = { "run", "G", "N", "fit.mean", "fit.sd", "fit.q05", "fit.q25", "fit.q50", "fit.q75", "fit.q95",
+                                      "foraged", "handled", "forager", "klept", "conditional", "parents", "turnover", "clades" };
+    for (int k = 0; k < W; ++k) {
+      cols.push_back("w" + std::to_string(k) + ".mean");
+      cols.push_back("w" + std::to_string(k) + ".sd");
+    }
+
+    // binary: uint32 columns, uint32 runs, zero terminated column and run names, double rows
+    const bool binary = out.extension() == ".bin";
+    std::ofstream os(out, binary ? std::ios::out | std::ios::binary : std::ios::out);
+    if (!os.is_open()) throw std::runtime_error("can't create output file");
+    if (binary) {
+      const uint32_t header[2] = { uint32_t(cols.size()), uint32_t(runs.size()) };
+      os.write((const char*)header, sizeof(header));
+      for (const auto& c : cols) os.write(c.c_str(), c.size() + 1);
+      for (const auto& r : runs) os.write(r.dir.filename().string().c_str(), r.dir.filename().string().size() + 1);
+    }
+    else {
+      for (size_t c = 0; c < cols.size(); ++c) os << (c ? "," : "") << cols[c];
+      os << '\n';
+    }
+    for (size_t r = 0; r < runs.size(); ++r) {
+      auto rows = analyse_run(runs[r]);
+      for (auto& row : rows) {
+        row.resize(cols.size() - 1, NA);
+        if (binary) {
+          const double run = double(r);
+          os.write((const char*)&run, sizeof(double));
+          os.write((const char*)row.data(), row.size() * sizeof(double));
+        }
+        else {
+          os << runs[r].dir.filename().string();
+          for (double x : row) {
+            os << ',';
+            if (std::isnan(x)) os << "NA"; else os << x;
+          }
+          os << '\n';
+        }
+      }
+      std::cout << runs[r].dir.string() << ": " << rows.size() << " generations\n";
+    }
+    return 0;
+  }
+  catch (cmd::parse_error& err) {
+    std::cerr << "\nParameter trouble: " << err.what() << '\n';
+  }
+  catch (std::exception& err) {
+    std::cerr << "\nExeption caught: " << err.what() << '\n';
+  }
+  catch (...) {
+    std::cerr << "\nUnknown exeption caught\n";
+  }
+  return 1;
+}
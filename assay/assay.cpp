@@ -0,0 +1,186 @@
+#include <omp.h>
+#include <iostream>
+#include <fstream>
+#include <numeric>
+#include <iterator>
+#include <cine/cmd_line.h>
+#include <cine/archive.hpp>
+#include <cine/any_ann.hpp>
+
+
+using namespace archive;
+using namespace cine2;
+
+
+// Reaction norms of archived ANNs.
+//
+// Evaluates the genomes of the selected generations of agents_ann.arc on a
+// regular grid of n points per input between lo and hi. Identical genomes
+// are evaluated once.
+//
+// output file layout:
+//   int32 P (grid points), I (inputs), O (outputs)
+//   float grid[P][I], input 0 varies fastest
+//   rows: float { G, count, idx, response[P][O] }
+//   rows are grouped by generation, unique genomes in order of decreasing count,
+//   idx is the first individual carrying the genome.
+
+
+namespace {
+
+  struct observed_range
+  {
+    std::vector<float> lo, hi;
+  };
+
+
+  // input ranges over the selected generations from agents_input.bin
+  observed_range input_range(const fs::path& file, const std::vector<int>& gens, int I)
+  {
+    std::ifstream is(file, std::ios::in | std::ios::binary);
+    if (!is.is_open()) throw std::runtime_error("can't open agents_input.bin");
+    const size_t stride = 5 * I;    // min, max, mean, sd, mad per input
+    std::vector<std::vector<double>> recs;
+    std::vector<double> rec(stride);
+    while (is.read((char*)rec.data(), stride * sizeof(double))) recs.push_back(rec);
+    observed_range res{ std::vector<float>(I, std::numeric_limits<float>::max()), std::vector<float>(I, -std::numeric_limits<float>::max()) };
+    for (int g : gens) {
+      if (g >= static_cast<int>(recs.size())) throw std::runtime_error("generation not in agents_input.bin");
+      for (int j = 0; j < I; ++j) {
+        res.lo[j] = std::min(res.lo[j], static_cast<float>(recs[g][5 * j]));
+        res.hi[j] = std::max(res.hi[j], static_cast<float>(recs[g][5 * j + 1]));
+      }
+    }
+    return res;
+  }
+
+
+  uint64_t hash_genome(const float* w, int n)
+  {
+    uint64_t h = 0xcbf29ce484222325ull;   // FNV-1a
+    const unsigned char* p = (const unsigned char*)w;
+    for (size_t i = 0; i < n * sizeof(float); ++i) {
+      h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+    return h;
+  }
+
+}
+
+
+int main(int argc, const char** argv)
+{
+  try {
+    cmd::cmd_line_parser clp(argc, argv);
+    auto dir = clp.required<fs::path>("dir");
+    auto out = clp.optional_val("out", dir / "agents_rsp.bin");
+    const int n = clp.optional_val("n", 11);
+    if (n < 2) throw cmd::parse_error("n shall be > 1");
+    omp_set_num_threads(clp.optional_val("omp_threads", omp_get_max_threads()));
+
+    iarch ia(dir / "agents_ann.arc");
+    const int Gmax = static_cast<int>(ia.size());
+    cmd::parse_vector<int> gens;
+    if (!clp.optional("G", gens)) {
+      gens.res_.resize(Gmax);
+      std::iota(gens.res_.begin(), gens.res_.end(), 0);
+    }
+    for (int g : gens.res_) {
+      if (g < 0 || g >= Gmax) throw cmd::parse_error("G out of range");
+    }
+
+    // the archive header names the ann type, L is irrelevant for evaluation
+    auto ann = make_any_ann(3, 1, ia.header().c_str());
+    if (!ann) throw std::runtime_error("unknown ANN type in agents_ann.arc");
+    const int I = ann->input_size();
+    const int O = ann->output_size();
+    const int W = ann->state_size();
+
+    // input grid: explicit range or observed range over the selected generations
+    cmd::parse_vector<float> lo, hi;
+    observed_range range;
+    const bool has_lo = clp.optional("lo", lo);
+    const bool has_hi = clp.optional("hi", hi);
+    if (!has_lo || !has_hi) {
+      range = input_range(dir / "agents_input.bin", gens.res_, I);
+    }
+    if (!lo.res_.empty()) range.lo = lo.res_;
+    if (!hi.res_.empty()) range.hi = hi.res_;
+    if (range.lo.size() != size_t(I) || range.hi.size() != size_t(I)) throw cmd::parse_error("lo and hi shall have one value per input");
+    int P = 1;
+    for (int j = 0; j < I; ++j) P *= n;
+    std::vector<float> grid(static_cast<size_t>(P) * I);
+    for (int p = 0; p < P; ++p) {
+      for (int j = 0, q = p; j < I; ++j, q /= n) {
+        grid[p * I + j] = range.lo[j] + (range.hi[j] - range.lo[j]) * (q % n) / (n - 1);
+      }
+    }
+    auto unrecognized = clp.unrecognized();
+    if (!unrecognized.empty()) throw cmd::parse_error("unknown argument '" + unrecognized.front() + "'");
+
+    std::filebuf fb;
+    fb.open(out, std::ios::out | std::ios::binary);
+    if (!fb.is_open()) throw std::runtime_error("can't create output file");
+    const int32_t header[3] = { P, I, O };
+    fb.sputn((const char*)header, sizeof(header));
+    fb.sputn((const char*)grid.data(), grid.size() * sizeof(float));
+
+    const int R = 3 + P * O;
+    std::vector<float> rows;
+    for (int g : gens.res_) {
+      auto cm = ia.extract(g);
+      if (cm.usize != W * sizeof(float)) throw std::runtime_error("ANN state size doesn't match");
+      const int N = static_cast<int>(cm.un);
+      if (ann->N() != N) ann = make_any_ann(3, N, ia.header().c_str());
+      uncompress(ann->data(), cm, ann->stride() * sizeof(float));
+
+      // unique genomes
+      std::vector<uint64_t> hash(N);
+#     pragma omp parallel for schedule(static)
+      for (int i = 0; i < N; ++i) hash[i] = hash_genome((*ann)[i], W);
+      std::vector<int> order(N);
+      std::iota(order.begin(), order.end(), 0);
+      const auto& cann = *ann;
+      std::sort(order.begin(), order.end(), [&](int a, int b) {
+        if (hash[a] != hash[b]) return hash[a] < hash[b];
+        const int c = std::memcmp(cann[a], cann[b], W * sizeof(float));
+        return (c != 0) ? c < 0 : a < b;
+      });
+      std::vector<std::pair<int, int>> unique;   // {count, first idx}
+      for (int i = 0; i < N; ++i) {
+        const int a = order[i];
+        if (i && hash[a] == hash[order[i - 1]] && 0 == std::memcmp(cann[a], cann[order[i - 1]], W * sizeof(float))) {
+          ++unique.back().first;
+        }
+        else {
+          unique.emplace_back(1, a);
+        }
+      }
+      std::stable_sort(unique.begin(), unique.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+      const int U = static_cast<int>(unique.size());
+      rows.resize(static_cast<size_t>(U) * R);
+#     pragma omp parallel for schedule(dynamic, 16)
+      for (int u = 0; u < U; ++u) {
+        float* row = rows.data() + static_cast<size_t>(u) * R;
+        row[0] = static_cast<float>(g);
+        row[1] = static_cast<float>(unique[u].first);
+        row[2] = static_cast<float>(unique[u].second);
+        cann.evaluate(unique[u].second, grid.data(), P, row + 3);
+      }
+      fb.sputn((const char*)rows.data(), rows.size() * sizeof(float));
+      std::cout << "G=" << g << ": " << U << " unique genomes\n";
+    }
+    return 0;
+  }
+  catch (cmd::parse_error& err) {
+    std::cerr << "\nParameter trouble: " << err.what() << '\n';
+  }
+  catch (std::exception& err) {
+    std::cerr << "\nExeption caught: " << err.what() << '\n';
+  }
+  catch (...) {
+    std::cerr << "\nUnknown exeption caught\n";
+  }
+  return 1;
+}
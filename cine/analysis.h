@@ -3,6 +3,7 @@
 
 #include <array>
 #include <vector>
+#include "landscape.h"
 
 
 namespace cine2 {
@@ -43,7 +44,7 @@ namespace cine2 {
     //const std::array<std::vector<Input>, 3>& pred_input() const { return input_[1]; }
 
   private:
-    static Input reduce(const class LayerView& view, class LayerView& tmp);
+    static Input reduce(const Landscape& landscape, Landscape::Layers layer);
     void assess_input(const class Simulation* sim) const;
     Summary assess_summary(const struct Population& Pop) const;
 
@@ -1,26 +1,33 @@
 #include <stdexcept>
 #include "any_ann.hpp"
 #include "simulation.h"
+#include "partition.h"
 
 
 namespace cine2 {
 
 
-  any_ann::any_ann(int N, int state_size, int size)
+  any_ann::any_ann(int N, int state_size, int size, const std::string& store)
     : N_(N),
     state_size_(state_size),
     size_(size),
     state_(nullptr)
   {
-
-    state_ = (float*)_mm_malloc(N_ * size_ * sizeof(float), 16);
-    std::memset(state_, 0, N_ * size_ * sizeof(float));
+    const size_t bytes = static_cast<size_t>(N_) * size_;
+    if (store.empty()) {
+      state_ = (float*)_mm_malloc(bytes, 16);
+      std::memset(state_, 0, bytes);
+    }
+    else {
+      map_.reset(new mapped_memory(store, bytes));    // zero-filled
+      state_ = static_cast<float*>(map_->data());
+    }
   }
 
 
   any_ann::~any_ann()
   {
-    _mm_free(state_);
+    if (!map_) _mm_free(state_);
   }
 
 
@@ -130,11 +137,15 @@ namespace cine2 {
     static_assert(std::is_trivially_copyable<ANN>::value, "Who messed with the Ann class?");
 
   public:
-    explicit concrete_ann(int N) : any_ann(N, ANN::state_size, sizeof(ANN))
+    concrete_ann(int N, const std::string& store) : any_ann(N, ANN::state_size, sizeof(ANN), store)
     {
     }
 
 
+    int input_size() const override { return static_cast<int>(ANN::input_size); }
+    int output_size() const override { return static_cast<int>(ANN::output_size); }
+
+
     float complexity(int idx) const override
     {
       const ANN* __restrict pann = reinterpret_cast<const ANN*>(state_);
@@ -144,9 +155,24 @@ namespace cine2 {
     }
 
 
+    void evaluate(int idx, const float* input, int n, float* output) const override
+    {
+      const ANN& stored = reinterpret_cast<const ANN*>(state_)[idx];
+      typename ANN::input_t in;
+      for (int i = 0; i < n; ++i, input += ANN::input_size, output += ANN::output_size) {
+        ANN ann = stored;     // fresh copy per input: feedback scratch doesn't carry over between probes
+        std::copy(input, input + ANN::input_size, in.begin());
+        const auto out = ann(in);
+        std::copy(out.cbegin(), out.cend(), output);
+      }
+    }
+
+
     void move(const Landscape& landscape,
       std::vector<Individual>& pop,
-      const Param::ind_param& iparam) override
+      const Param::ind_param& iparam,
+      Trajectories* tracks,
+      const Partition* owners) override
     {
       using Layers = Landscape::Layers;
       using env_info_t = std::array<float, L * L>;
@@ -160,9 +186,9 @@ namespace cine2 {
 
       ANN* __restrict pann = reinterpret_cast<ANN*>(state_);
       const int N = static_cast<int>(iparam.N);
+      prefetch(0, std::min(N, prefetch_window));
       const auto noise = std::uniform_real_distribution<float>(1.0f - iparam.noise_sigma, 1.0f + iparam.noise_sigma);
-#   pragma omp parallel for schedule(static,128)
-      for (int p = 0; p < N; ++p) {							//cycle thrugh the agents
+      auto move_one = [&](int p) {
         if (pop[p].alive() && !(pop[p].handle())) {			//conditions for movement (alive and not handling)
 
       //gather information from landscape
@@ -210,6 +236,10 @@ namespace cine2 {
             it = zip.begin() + rndutils::uniform_signed_distribution<int>(0, static_cast<int>(std::distance(zip.begin(), it)))(rnd::reng);
           }
           pop[p].pos = landscape.wrap(pos + Coordinate{ short((it->cell % L) - L / 2), short((it->cell / L) - L / 2) });
+          if (tracks) {
+            const int slot = tracks->slot(p);
+            if (slot >= 0) tracks->decide(slot, it->eval, it->eval2);
+          }
 
           /*
       double s_prob = 1.0 / (1.0 + exp(-static_cast<double> (it->eval2)));	//creating s_prob which is function of eval2
@@ -225,6 +255,18 @@ namespace cine2 {
           }
 
         }
+      };
+      if (owners) {
+        // every thread moves the agents of its own bands
+        owners->for_each_band([&](int b) {
+          for (auto it = owners->begin(b); it != owners->end(b); ++it) move_one(*it);
+        });
+      }
+      else {
+#   pragma omp parallel for schedule(static,128)
+        for (int p = 0; p < N; ++p) {							//cycle thrugh the agents
+          move_one(p);
+        }
       }
     }
 
@@ -234,6 +276,7 @@ namespace cine2 {
       ANN* __restrict pann = reinterpret_cast<ANN*>(state_);
       const int N = static_cast<int>(iparam.N);
       const ann_visitors::mutate mutate_visitor(iparam, fixed);
+      prefetch(0, std::min(N, prefetch_window));
 #   pragma omp parallel for schedule(static, 128)
       for (int i = 0; i < N; ++i) {
         ann::visit_neurons(pann[i], mutate_visitor);
@@ -254,30 +297,30 @@ namespace cine2 {
 
 
   template <int L, typename ANN>
-  std::unique_ptr<any_ann> make_any_ann_2(int N)
+  std::unique_ptr<any_ann> make_any_ann_2(int N, const std::string& store)
   {
-    return std::unique_ptr<any_ann>(new concrete_ann<L, ANN>(N));
+    return std::unique_ptr<any_ann>(new concrete_ann<L, ANN>(N, store));
   }
 
 
   template <int L>
-  std::unique_ptr<any_ann> make_any_ann_1(int N, const char* ann_descr)
+  std::unique_ptr<any_ann> make_any_ann_1(int N, const char* ann_descr, const std::string& store)
   {
-    if (0 == std::strcmp(ann_descr, "DumbAnn")) return make_any_ann_2<L, DumbAnn>(N);
-    if (0 == std::strcmp(ann_descr, "SimpleAnn")) return make_any_ann_2<L, SimpleAnn>(N);
-    if (0 == std::strcmp(ann_descr, "SimpleAnnFB")) return make_any_ann_2<L, SimpleAnnFB>(N);
-    if (0 == std::strcmp(ann_descr, "SmartAnn")) return make_any_ann_2<L, SmartAnn>(N);
+    if (0 == std::strcmp(ann_descr, "DumbAnn")) return make_any_ann_2<L, DumbAnn>(N, store);
+    if (0 == std::strcmp(ann_descr, "SimpleAnn")) return make_any_ann_2<L, SimpleAnn>(N, store);
+    if (0 == std::strcmp(ann_descr, "SimpleAnnFB")) return make_any_ann_2<L, SimpleAnnFB>(N, store);
+    if (0 == std::strcmp(ann_descr, "SmartAnn")) return make_any_ann_2<L, SmartAnn>(N, store);
     // ToDo: add your Anns here
     return nullptr;
   }
 
 
-  std::unique_ptr<any_ann> make_any_ann(int L, int N, const char* ann_descr)
+  std::unique_ptr<any_ann> make_any_ann(int L, int N, const char* ann_descr, const std::string& store)
   {
-    if (L == 3) return  make_any_ann_1<3>(N, ann_descr);
-    if (L == 5) return make_any_ann_1<5>(N, ann_descr);
-    if (L == 7) return make_any_ann_1<7>(N, ann_descr);
-    if (L == 33) return make_any_ann_1<33>(N, ann_descr);
+    if (L == 3) return  make_any_ann_1<3>(N, ann_descr, store);
+    if (L == 5) return make_any_ann_1<5>(N, ann_descr, store);
+    if (L == 7) return make_any_ann_1<7>(N, ann_descr, store);
+    if (L == 33) return make_any_ann_1<33>(N, ann_descr, store);
 
     // ToDo: add your Anns here
     std::runtime_error("Unknown Ann type");
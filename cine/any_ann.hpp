@@ -5,12 +5,18 @@
 #include <algorithm>
 #include <functional>
 #include <vector>
+#include <string>
 #include "parameter.h"
+#include "mapped_memory.h"
 
 
 namespace cine2 {
 
 
+  class Trajectories;
+  class Partition;
+
+
   // type erased wrapper for Anns
   class any_ann
   {
@@ -20,7 +26,8 @@ namespace cine2 {
     any_ann(const any_ann&) = delete;
     any_ann& operator=(const any_ann&) = delete;
 
-    any_ann(int N, int state_size, int size);
+    // store: folder of the memory-mapped state file, empty: in memory
+    any_ann(int N, int state_size, int size, const std::string& store);
     virtual ~any_ann();
 
     int N() const { return N_; }
@@ -33,11 +40,23 @@ namespace cine2 {
 
     int type_size() const { return size_; }
 
+    // state lives in a memory-mapped file
+    bool mapped() const { return map_ != nullptr; }
+
+    // ANNs prefetched at the start of a streaming pass, the read-ahead does the rest
+    static constexpr int prefetch_window = 1 << 16;
+
+    // hints that ANNs [begin, end) are about to be streamed, no-op in memory
+    void prefetch(int begin, int end) const
+    {
+      if (map_) map_->advise(static_cast<size_t>(begin) * size_, static_cast<size_t>(end - begin) * size_, mapped_memory::willneed);
+    }
+
     // returns pointer to first weight of ANN idx
-    float* operator[](int idx) { return (float*)((char*)state_ + idx * size_); }
+    float* operator[](int idx) { return (float*)((char*)state_ + static_cast<size_t>(idx) * size_); }
 
     // returns pointer to first const weight of ANN idx
-    const float* operator[](int idx) const { return (const float*)((const char*)state_ + idx * size_); }
+    const float* operator[](int idx) const { return (const float*)((const char*)state_ + static_cast<size_t>(idx) * size_); }
 
     // assign single ann
     void assign(const any_ann& src, int src_idx, int dst_idx)
@@ -48,9 +67,20 @@ namespace cine2 {
     float* data() { return state_; };
     const float* data() const { return state_; }
 
+    // number of inputs and outputs
+    virtual int input_size() const = 0;
+    virtual int output_size() const = 0;
+
     // Returns complexity of ann idx: 1 - (zero / weights)
     virtual float complexity(int idx) const = 0;
-    virtual void move(const Landscape& landscape, std::vector<Individual>& pop, const Param::ind_param& iparam) = 0;
+
+    // Feeds n consecutive input vectors through ann idx, writes n output vectors.
+    // Every input starts from the stored state, outputs don't depend on the order.
+    virtual void evaluate(int idx, const float* input, int n, float* output) const = 0;
+
+    // tracks: receives the decisions of tracked agents, nullptr if no agent is tracked
+    // owners: iterate the agents by owning thread (owner-computes), nullptr: by index
+    virtual void move(const Landscape& landscape, std::vector<Individual>& pop, const Param::ind_param& iparam, Trajectories* tracks, const Partition* owners) = 0;
     virtual void mutate(const Param::ind_param& iparam, bool fixed) = 0;
     virtual void initialize(const Param::ind_param& iparam) = 0;
 
@@ -59,11 +89,13 @@ namespace cine2 {
     int state_size_;
     int size_;
     float* state_;
+    std::unique_ptr<mapped_memory> map_;
   };
 
 
   // creates an any_ann from runtime parameters.
-  std::unique_ptr<any_ann> make_any_ann(int L, int N, const char* ann_descr);
+  // store: folder of the memory-mapped state file, empty: in memory
+  std::unique_ptr<any_ann> make_any_ann(int L, int N, const char* ann_descr, const std::string& store = std::string{});
 
 }
 
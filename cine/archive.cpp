@@ -1,51 +1,183 @@
 #include "archive.hpp"
 #include <stdexcept>
-#include <zlib/zlib.h>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
 
 
 namespace archive {
 
 
-  compressed_mem compress(const void* source, const size_t n, const size_t size, size_t stride)
+  namespace {
+
+    std::atomic<uint64_t> bytes_written_{ 0 };
+
+  }
+
+
+  uint64_t bytes_written()
+  {
+    return bytes_written_.load(std::memory_order_relaxed);
+  }
+
+
+  namespace {
+
+    const int32_t magic_v1 = 0x49484148;   // little endian ascii: 'HAHI'
+    const int32_t magic_v2 = 0x32484148;   // little endian ascii: 'HAH2'
+    const int32_t magic_v3 = 0x33484148;   // little endian ascii: 'HAH3'
+
+
+    // gathers n blobs of size bytes from a strided source
+    const unsigned char* gather(std::vector<unsigned char>& buf, const void* source, size_t n, size_t size, size_t stride)
+    {
+      if (stride == size) return (const unsigned char*)source;
+      buf.resize(n * size);
+      for (size_t i = 0; i < n; ++i) {
+        std::memcpy(buf.data() + i * size, (const char*)source + i * stride, size);
+      }
+      return buf.data();
+    }
+
+
+    // filter + codec, returns false on failure
+    bool encode(const method& m, const unsigned char* src, size_t n, std::vector<unsigned char>& fbuf, std::vector<unsigned char>& dst)
+    {
+      const auto& codec = get_codec(m.codec);
+      if (m.filter != method::nofilter) {
+        fbuf.resize(n);
+        apply_filter(m.filter, src, n, fbuf.data());
+        src = fbuf.data();
+      }
+      dst.resize(codec.bound(n));
+      const size_t csize = codec.encode(src, n, dst.data(), dst.size(), m.level);
+      dst.resize(csize);
+      return csize || !n;
+    }
+
+
+    // codec + inverse filter, returns false on failure
+    bool decode(const compressed_mem& cm, const unsigned char* src, size_t csize, unsigned char* dst, size_t n, std::vector<unsigned char>& fbuf)
+    {
+      const auto& codec = get_codec(static_cast<uint8_t>(cm.codec & 0xff));
+      if (cm.filter == method::nofilter) {
+        return codec.decode(src, csize, dst, n);
+      }
+      fbuf.resize(n);
+      if (!codec.decode(src, csize, fbuf.data(), n)) return false;
+      revert_filter(static_cast<uint8_t>(cm.filter), fbuf.data(), n, dst);
+      return true;
+    }
+
+  }
+
+
+  compressed_mem compress(const void* source, const size_t n, const size_t size, size_t stride, method m)
   {
-    const uLong bytes = static_cast<uLong>(n * size);
-    uLong destLen = static_cast<uLong>(1.1 * bytes + 128);
-    auto dst = compressed_mem::buffer((unsigned char*)std::malloc(destLen), std::free);
     stride = stride ? stride : size;
-    const uLong sourceLen = bytes;
-    int Z_RES;
-    if (stride == size) {
-      Z_RES = ::compress(dst.get(), &destLen, (const Bytef*)source, sourceLen);
+    check_method(m.codec, m.filter);    // nothing may throw inside the parallel region
+    const uint32_t codec = m.codec | (uint32_t(m.level) << 8);
+    const size_t bytes = n * size;
+    if (bytes <= block_size) {
+      std::vector<unsigned char> ibuf, fbuf, cbuf;
+      const unsigned char* src = gather(ibuf, source, n, size, stride);
+      if (!encode(m, src, bytes, fbuf, cbuf)) {
+        throw std::runtime_error("compression failed");
+      }
+      auto dst = compressed_mem::buffer((unsigned char*)std::malloc(std::max(size_t(1), cbuf.size())), std::free);
+      std::memcpy(dst.get(), cbuf.data(), cbuf.size());
+      return {static_cast<uint32_t>(n), static_cast<uint32_t>(size), static_cast<uint32_t>(cbuf.size()), std::move(dst), 0, codec, m.filter};
     }
-    else {
-      std::vector<unsigned char> ibuf(bytes);
-      for (size_t i = 0; i < n; ++i) {
-        std::memcpy(ibuf.data() + i * size, (const char*)source + i * stride, size);
+
+    // block mode
+    const size_t bpb = std::max(size_t(1), block_size / size);    // blobs per block
+    const int blocks = static_cast<int>((n + bpb - 1) / bpb);
+    std::vector<std::vector<unsigned char>> cblocks(blocks);
+    bool failed = false;
+#   pragma omp parallel
+    {
+      std::vector<unsigned char> ibuf, fbuf;
+#     pragma omp for schedule(dynamic)
+      for (int b = 0; b < blocks; ++b) {
+        const size_t first = b * bpb;
+        const size_t bn = std::min(bpb, n - first);
+        const unsigned char* src = gather(ibuf, (const char*)source + first * stride, bn, size, stride);
+        if (!encode(m, src, bn * size, fbuf, cblocks[b])) {
+          failed = true;
+        }
       }
-      Z_RES = ::compress(dst.get(), &destLen, (const Bytef*)ibuf.data(), sourceLen);
     }
-    if (Z_OK != Z_RES) {
-      throw std::runtime_error("compression failed");
+    if (failed) throw std::runtime_error("compression failed");
+    size_t csize = sizeof(uint32_t) * (1 + blocks);
+    for (const auto& cb : cblocks) csize += cb.size();
+    auto dst = compressed_mem::buffer((unsigned char*)std::malloc(csize), std::free);
+    uint32_t* table = (uint32_t*)dst.get();
+    table[0] = static_cast<uint32_t>(bpb);
+    unsigned char* p = dst.get() + sizeof(uint32_t) * (1 + blocks);
+    for (int b = 0; b < blocks; ++b) {
+      table[1 + b] = static_cast<uint32_t>(cblocks[b].size());
+      std::memcpy(p, cblocks[b].data(), cblocks[b].size());
+      p += cblocks[b].size();
     }
-    return {static_cast<uint32_t>(n), static_cast<uint32_t>(size), destLen, std::move(dst)};
+    return {static_cast<uint32_t>(n), static_cast<uint32_t>(size), static_cast<uint32_t>(csize), std::move(dst), static_cast<uint32_t>(blocks), codec, m.filter};
   }
 
 
   void uncompress(void* dst, const compressed_mem& src, size_t stride)
   {
-    uLong destLen = static_cast<uLong>(src.un * src.usize + 128);
-    std::vector<unsigned char> ubuf(destLen);
-    if (Z_OK != ::uncompress(ubuf.data(), &destLen, (const Bytef*)src.cbuf.get(), src.csize)) {
-      throw std::runtime_error("decmpression failed");
-    }
-    if (stride == 0 || src.usize == stride) {
-      std::memcpy(dst, ubuf.data(), static_cast<uLong>(src.un) * src.usize);
+    check_method(src.codec & 0xff, src.filter);    // nothing may throw inside the parallel region
+    const size_t usize = src.usize;
+    stride = stride ? stride : usize;
+    if (src.blocks == 0) {
+      const size_t bytes = size_t(src.un) * usize;
+      std::vector<unsigned char> ubuf, fbuf;
+      unsigned char* out = (unsigned char*)dst;
+      if (stride != usize) {
+        ubuf.resize(bytes);
+        out = ubuf.data();
+      }
+      if (!decode(src, src.cbuf.get(), src.csize, out, bytes, fbuf)) {
+        throw std::runtime_error("decmpression failed");
+      }
+      if (stride != usize) {
+        for (size_t i = 0; i < src.un; ++i) {
+          std::memcpy((char*)dst + i * stride, ubuf.data() + i * usize, usize);
+        }
+      }
+      return;
     }
-    else {
-      for (size_t i = 0; i < src.un; ++i) {
-        std::memcpy((char*)dst + i * stride, ubuf.data() + i * src.usize, src.usize);
+
+    // block mode
+    const int blocks = static_cast<int>(src.blocks);
+    const uint32_t* table = (const uint32_t*)src.cbuf.get();
+    const size_t bpb = table[0];
+    std::vector<size_t> offset(blocks + 1, sizeof(uint32_t) * (1 + blocks));
+    for (int b = 0; b < blocks; ++b) offset[b + 1] = offset[b] + table[1 + b];
+    if (offset.back() != src.csize) throw std::runtime_error("decmpression failed: corrupt block table");
+    bool failed = false;
+#   pragma omp parallel
+    {
+      std::vector<unsigned char> ubuf, fbuf;
+#     pragma omp for schedule(dynamic)
+      for (int b = 0; b < blocks; ++b) {
+        const size_t first = b * bpb;
+        const size_t bn = std::min(bpb, size_t(src.un) - first);
+        unsigned char* out = (unsigned char*)dst + first * stride;
+        if (stride != usize) {
+          ubuf.resize(bn * usize);
+          out = ubuf.data();
+        }
+        if (!decode(src, src.cbuf.get() + offset[b], table[1 + b], out, bn * usize, fbuf)) {
+          failed = true;
+        }
+        else if (stride != usize) {
+          for (size_t i = 0; i < bn; ++i) {
+            std::memcpy((char*)dst + (first + i) * stride, ubuf.data() + i * usize, usize);
+          }
+        }
       }
     }
+    if (failed) throw std::runtime_error("decmpression failed");
   }
 
 
@@ -69,8 +201,7 @@ namespace archive {
     if (!fb_.is_open()) throw std::runtime_error("can't create oarch");
 
     // insert magic number for endianness test
-    int32_t magic = 0x49484148;   // little endian ascii: 'HAHI'
-    fb_.sputn((char*)&magic, 4);
+    fb_.sputn((char*)&magic_v3, 4);
 
     // insert placeholder for dictionary offset
     uint64_t dictofs(0);
@@ -92,6 +223,7 @@ namespace archive {
     uint32_t dsize = static_cast<uint32_t>(dict_.size());
     fb_.sputn((char*)&dsize, 4);
     if (dsize) fb_.sputn((char*)dict_.data(), dsize * sizeof(dict));    
+    bytes_written_.fetch_add(4 + dsize * sizeof(dict), std::memory_order_relaxed);
     
     // write position of dictionary
     fb_.pubseekoff(4, std::ios_base::beg);
@@ -105,7 +237,8 @@ namespace archive {
    {
      uint64_t pend = fb_.pubseekoff(0, std::ios_base::end);
      fb_.sputn((char*)cm.cbuf.get(), cm.csize);
-     dict_.push_back({pend, cm.csize, cm.un, cm.usize});
+     dict_.push_back({pend, cm.csize, cm.un, cm.usize, cm.blocks, cm.codec, cm.filter});
+     bytes_written_.fetch_add(cm.csize, std::memory_order_relaxed);
    }
 
 
@@ -130,8 +263,8 @@ namespace archive {
      // read magic number for endianess test
      int32_t magic = 0;
      fb_.sgetn((char*)&magic, 4);
-     if (magic == 0x41484948) throw std::runtime_error("oarch: invalid endianness");
-     if (magic != 0x49484148) throw std::runtime_error("oarch: corrupt archive");
+     if (magic == 0x48414849 || magic == 0x48414832 || magic == 0x48414833) throw std::runtime_error("oarch: invalid endianness");
+     if (magic != magic_v1 && magic != magic_v2 && magic != magic_v3) throw std::runtime_error("oarch: corrupt archive");
 
      // read dictionary offset
      uint64_t pdict(0);
@@ -146,8 +279,25 @@ namespace archive {
      fb_.pubseekoff(pdict, std::ios_base::beg);
      uint32_t dsize = static_cast<uint32_t>(dict_.size());
      fb_.sgetn((char*)&dsize, 4);
-     dict_.resize(dsize, {0,0,0,0});
-     fb_.sgetn((char*)dict_.data(), dsize * sizeof(dict));
+     if (magic == magic_v3) {
+       dict_.resize(dsize, {0,0,0,0,0,0,0});
+       fb_.sgetn((char*)dict_.data(), dsize * sizeof(dict));
+       for (const auto& d : dict_) check_method(d.codec & 0xff, d.filter);
+     }
+     else {
+       // v1 entries lack the blocks field, v1 and v2 entries the codec and filter fields (zlib, unfiltered)
+       const size_t esize = (magic == magic_v2) ? 24 : 20;
+       std::vector<char> buf(dsize * esize);
+       fb_.sgetn(buf.data(), buf.size());
+       dict_.clear();
+       for (uint32_t i = 0; i < dsize; ++i) {
+         uint64_t ppos;
+         uint32_t v[4] = { 0, 0, 0, 0 };
+         std::memcpy(&ppos, buf.data() + i * esize, 8);
+         std::memcpy(v, buf.data() + i * esize + 8, esize - 8);
+         dict_.push_back({ppos, v[0], v[1], v[2], v[3], method::zlib, method::nofilter});
+       }
+     }
    }
 
 
@@ -166,7 +316,7 @@ namespace archive {
 
      auto cbuf = compressed_mem::buffer((unsigned char*)std::malloc(dict.csize), std::free);
      fb_.sgetn((char*)cbuf.get(), dict.csize);
-     return {dict.un, dict.usize, dict.csize, std::move(cbuf)};
+     return {dict.un, dict.usize, dict.csize, std::move(cbuf), dict.blocks, dict.codec, dict.filter};
    }
 
 }
@@ -6,6 +6,7 @@
 #include <vector>
 #include <fstream>
 #include <filesystem>
+#include "codec.hpp"
 
 
 namespace fs = std::filesystem;
@@ -14,6 +15,16 @@ namespace fs = std::filesystem;
 namespace archive {
 
 
+  // Archive format v3 ('HAH3'): every entry records its codec and filter
+  // (see codec.hpp). Payloads larger than block_size are split into
+  // independently compressed blocks of whole blobs, laid out as
+  //   uint32 blobs per block, uint32 csize[blocks], compressed blocks.
+  // Small payloads are a single compressed stream (blocks = 0).
+  // v2 ('HAH2', blocks but zlib only) and v1 ('HAHI', single zlib streams)
+  // archives are still read.
+  const size_t block_size = 1 << 20;
+
+
   struct compressed_mem
   {
     using buffer = std::unique_ptr<unsigned char, decltype(std::free)*>;
@@ -22,20 +33,30 @@ namespace archive {
     const uint32_t usize;     // uncompressed blob-size [byte]
     const uint32_t csize;     // compressed buffer size
     buffer cbuf;              // compressed buffer
+    const uint32_t blocks;    // number of blocks, 0: single stream
+    const uint32_t codec;     // method::codec_t | level << 8
+    const uint32_t filter;    // method::filter_t
   };
 
 
+  // blocks are compressed in parallel
   compressed_mem compress(const void* source, 
                           const size_t n, 
                           const size_t size, 
-                          size_t stride = 0);
+                          size_t stride = 0,
+                          method m = method{});
 
 
+  // decodes any codec and filter, blocks are decompressed in parallel
   void uncompress(void* dst, 
                   const compressed_mem& src, 
                   size_t stride = 0);
 
 
+  // total bytes written by all oarchs of this process
+  uint64_t bytes_written();
+
+
 # pragma pack(push, 1)
   struct dict
   {
@@ -43,6 +64,9 @@ namespace archive {
     const uint32_t csize;     // compressed size
     const uint32_t un;        // number of blobs
     const uint32_t usize;     // uncompressed blob-size [byte]
+    const uint32_t blocks;    // number of blocks, 0: single stream (not stored in v1)
+    const uint32_t codec;     // method::codec_t | level << 8 (not stored in v1, v2)
+    const uint32_t filter;    // method::filter_t (not stored in v1, v2)
   };
 # pragma pack(pop)
 
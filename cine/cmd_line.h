@@ -105,6 +105,7 @@ namespace cmd {
           {
             p0++; 
             delim = [](char chr) { return chr == '\"'; };
+            continue;     // "" is an empty value
           }
           if (*p0 == '#') 
           {
@@ -222,6 +223,13 @@ namespace cmd {
   }
 
 
+  // strings take the whole value, which may be empty
+  inline void convert_arg(std::pair<std::string, std::string> const& arg, std::string& x)
+  {
+    x = arg.second;
+  }
+
+
   inline void parse_cmd_flag(const char* name, bool& val, const std::vector<std::string>& argv)
   {
     for (const auto& arg : argv) 
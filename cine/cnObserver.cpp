@@ -31,14 +31,23 @@ import.generation <- function(G, what, stderr) {
   extractor <- paste0(config$dir, '/depends/extract.exe')
   Args <- paste0('G="', toString(G), '" ' , "dir=", config$dir, " what=", what)
   system2(extractor, args=Args, stderr=stderr)
-  ann <- matrix(import.raw(paste0(config$dir, "/tmp/", what, "_ann.tmp"), numeric(), 8),
-                ncol=config[[paste0(what, ".ann.weights")]], byrow=T)
-  fit <- import.raw(paste0(config$dir, "/tmp/", what, "_fit.tmp"), numeric(), 8)
-  anc <- import.raw(paste0(config$dir, "/tmp/", what, "_anc.tmp"), integer(), 4)
-  foa <- import.raw(paste0(config$dir, "/tmp/", what, "_foa.tmp"), numeric(), 8)
-  han <- import.raw(paste0(config$dir, "/tmp/", what, "_han.tmp"), numeric(), 8)
+  tmp <- function(ext) paste0(config$dir, "/tmp/", what, "_", ext, ".tmp")
+  opt <- function(ext, type, size) if (file.exists(tmp(ext))) import.raw(tmp(ext), type, size) else NULL
+  mat <- function(x, cols) if (is.null(x)) NULL else matrix(x, ncol=config[[paste0(what, cols)]], byrow=T)
+  ann <- mat(opt("ann", numeric(), 8), ".ann.weights")
+  fit <- opt("fit", numeric(), 8)
+  anc <- opt("anc", integer(), 4)
+  foa <- opt("foa", numeric(), 8)
+  han <- opt("han", numeric(), 8)
+  str <- mat(opt("str", numeric(), 8), ".strategy.cols")
+  # output.mode="summary": one row per variable (fitness, foraged, handled, weights)
+  # min, max, mean, sd, q05, q25, q50, q75, q95, hist.lo, hist.hi, histogram counts
+  dst <- mat(opt("dst", numeric(), 8), ".dst.cols")
+  # spatial.rmax > 0: one row per layer pair
+  # layer.a, layer.b, mean.a, mean.b, cov, patchiness, corr[0..rmax]
+  spa <- mat(opt("spa", numeric(), 8), ".spatial.cols")
   system2(extractor, paste0("dir=", config$dir, " --cleanup"))
-  list(ann=ann, fit=fit, anc=anc, foa=foa, han=han)
+  list(ann=ann, fit=fit, anc=anc, foa=foa, han=han, str=str, dst=dst, spa=spa)
 }
 
 # extract generation
@@ -69,6 +78,60 @@ summary <- function() {
 #  colnames(pred) <- cn
   list(agents=agents) #CN: pred excluded, pred=pred
 }
+
+# load pruned genealogy (requires genealogy=1)
+#   tree  : gen, idx, parent (0-based row index, -1 for roots)
+#   tmrca : generations to the most recent common ancestor, -1 if not coalesced
+genealogy <- function() {
+  tree = matrix(import.raw(paste0(config$dir, '/agents_gen.bin'), integer(), 4), ncol=3, byrow=T)
+  colnames(tree) <- c('gen', 'idx', 'parent')
+  tmrca = import.raw(paste0(config$dir, '/agents_tmrca.bin'), integer(), 4)
+  list(tree=tree, tmrca=tmrca)
+}
+
+# load conflict event log (requires conflicts.log=1)
+#   g, t, cell (y * dim + x), attacker, victim, outcome (1: attacker won)
+conflicts <- function(stderr=F) {
+  extractor <- paste0(config$dir, '/depends/extract.exe')
+  system2(extractor, args=paste0("dir=", config$dir, " --conflicts"), stderr=stderr)
+  ev = matrix(import.raw(paste0(config$dir, '/tmp/conflicts.tmp'), integer(), 4), ncol=6, byrow=T)
+  system2(extractor, paste0("dir=", config$dir, " --cleanup"))
+  colnames(ev) <- c('g', 't', 'cell', 'attacker', 'victim', 'outcome')
+  ev
+}
+
+# load agent trajectories (requires trajectory.k > 0)
+#   state bits: 1 alive, 2 handling, 4 foraging, 8 just lost
+#   eval, eval2: preference and strategy output of the chosen cell, NaN if the agent didn't move
+trajectories <- function(stderr=F) {
+  extractor <- paste0(config$dir, '/depends/extract.exe')
+  system2(extractor, args=paste0("dir=", config$dir, " --trajectories"), stderr=stderr)
+  trj = matrix(import.raw(paste0(config$dir, '/tmp/trajectories.tmp'), numeric(), 8), ncol=9, byrow=T)
+  system2(extractor, paste0("dir=", config$dir, " --cleanup"))
+  colnames(trj) <- c('g', 't', 'idx', 'x', 'y', 'state', 'food', 'eval', 'eval2')
+  trj
+}
+
+# reaction norms of the archived genomes (requires depends/assay.exe)
+#   G : generations, default: all
+#   n : grid points per input, the grid spans the observed input range
+#   grid     : P x I input matrix, input 0 varies fastest
+#   response : one row per unique genome: P x O outputs, output 0 varies fastest
+response <- function(G=NULL, n=11, stderr=F) {
+  assay <- paste0(config$dir, '/depends/assay.exe')
+  out <- paste0(config$dir, '/tmp/agents_rsp.bin')
+  dir.create(paste0(config$dir, '/tmp'), showWarnings=F)
+  Args <- paste0("dir=", config$dir, " n=", n, " out=", out)
+  if (!is.null(G)) Args <- paste0(Args, ' "G={', paste(G, collapse=','), '}"')
+  system2(assay, args=Args, stdout=F, stderr=stderr)
+  con <- file(out, "rb")
+  h <- readBin(con, integer(), 3, size=4)
+  grid <- matrix(readBin(con, numeric(), h[1] * h[2], size=4), ncol=h[2], byrow=T)
+  rsp <- matrix(readBin(con, numeric(), file.info(out)$size / 4, size=4), ncol=3 + h[1] * h[3], byrow=T)
+  close(con)
+  unlink(out)
+  list(grid=grid, G=rsp[,1], count=rsp[,2], idx=rsp[,3], response=rsp[,-(1:3), drop=F])
+}
   
 config$dir = getSrcDirectory(generation)[1]
 )R";
@@ -94,7 +157,15 @@ config$dir = getSrcDirectory(generation)[1]
       using msg_type = Simulation::msg_type;
       
       switch (msg) {
-        case msg_type::INITIALIZED:
+        case msg_type::INITIALIZED: {
+          const auto& output = sim->param().output;
+          method_ = archive::parse_method(output.codec);
+          method_ann_ = output.codec_ann.empty() ? method_ : archive::parse_method(output.codec_ann);
+          summary_ = (output.mode == "summary");
+          if (summary_) {
+            oa_agents_dst_.open(folder / "agents_dst.arc", "distribution");
+            break;
+          }
           oa_agents_ann_.open(folder / "agents_ann.arc", sim->param().agents.ann);
           oa_agents_fit_.open(folder / "agents_fit.arc", "fitness");
           oa_agents_anc_.open(folder / "agents_anc.arc", "ancestors");
@@ -102,14 +173,24 @@ config$dir = getSrcDirectory(generation)[1]
           oa_agents_han_.open(folder / "agents_han.arc", "handle");
 
           break;
+        }
         case msg_type::GENERATION:
+          if (summary_) {
+            stream_distribution(sim->agents(), sim->param().output.bins, oa_agents_dst_);
+            break;
+          }
           stream_generation(sim->agents(), oa_agents_ann_, oa_agents_fit_, oa_agents_anc_, oa_agents_foa_, oa_agents_han_);
 
           break;
         case msg_type::FINISHED:
           stream_meta(sim);
           stream_analysis(sim);
+          if (sim->param().genealogy) stream_genealogy(sim->genealogy());
           copy_dependencies();
+          // complete the archives now, later observers may copy them
+          for (auto* oa : { &oa_agents_ann_, &oa_agents_fit_, &oa_agents_anc_, &oa_agents_foa_, &oa_agents_han_, &oa_agents_dst_ }) {
+            oa->close();
+          }
           break;
       }
       return notify_next(userdata, msg);
@@ -126,20 +207,82 @@ config$dir = getSrcDirectory(generation)[1]
       oa_ann.insert(archive::compress(Pop.ann->data(),
                                       Pop.ann->N(),
                                       Pop.ann->state_size() * sizeof(float),
-                                      Pop.ann->stride() * sizeof(float)));
+                                      Pop.ann->stride() * sizeof(float),
+                                      method_ann_));
       oa_fit.insert(archive::compress(Pop.fitness.data(),
                                       Pop.fitness.size(),
-                                      sizeof(float)));
+                                      sizeof(float),
+                                      0,
+                                      method_));
       oa_anc.insert(archive::compress((char*)Pop.pop.data() + offsetof(Individual, ancestor),
                                       Pop.pop.size(),
                                       sizeof(int),
-                                      sizeof(Individual)));
+                                      sizeof(Individual),
+                                      method_));
       oa_foa.insert(archive::compress(Pop.foraged.data(),
                                       Pop.foraged.size(),
-                                      sizeof(float)));
+                                      sizeof(float),
+                                      0,
+                                      method_));
       oa_han.insert(archive::compress(Pop.handled.data(),
                                       Pop.handled.size(),
-                                      sizeof(float)));
+                                      sizeof(float),
+                                      0,
+                                      method_));
+    }
+
+
+    // Fixed-size record per variable: 
+    // min, max, mean, sd, q05, q25, q50, q75, q95, hist_lo, hist_hi, counts[bins]
+    // Variables: fitness, foraged, handled, ann weights
+    // The histogram spans [q01, q99] ([q01, q01 + 1] if q01 == q99), the outer bins collect the tails.
+    void stream_distribution(const Population& Pop, const int bins, archive::oarch& oa_dst)
+    {
+      static const float Q[] = { 0.05f, 0.25f, 0.5f, 0.75f, 0.95f, 0.01f, 0.99f };
+      const int N = static_cast<int>(Pop.pop.size());
+      const int W = Pop.ann->state_size();
+      const int V = 3 + W;
+      const int R = 11 + bins;
+      dst_.resize(static_cast<size_t>(V) * R);
+#     pragma omp parallel
+      {
+        std::vector<float> x(N);
+        histogram hist;
+#       pragma omp for schedule(dynamic)
+        for (int v = 0; v < V; ++v) {
+          switch (v) {
+            case 0: std::copy(Pop.fitness.cbegin(), Pop.fitness.cend(), x.begin()); break;
+            case 1: std::copy(Pop.foraged.cbegin(), Pop.foraged.cend(), x.begin()); break;
+            case 2: std::copy(Pop.handled.cbegin(), Pop.handled.cend(), x.begin()); break;
+            default: for (int i = 0; i < N; ++i) x[i] = (*Pop.ann)[i][v - 3]; break;
+          }
+          float* rec = dst_.data() + v * R;
+          const auto mm = std::minmax_element(x.cbegin(), x.cend());
+          rec[0] = *mm.first;
+          rec[1] = *mm.second;
+          double sum = 0.0, sum2 = 0.0;
+          for (auto val : x) {
+            sum += val; 
+            sum2 += double(val) * val;
+          }
+          const double mean = sum / N;
+          rec[2] = static_cast<float>(mean);
+          rec[3] = static_cast<float>(std::sqrt(std::max(0.0, sum2 / N - mean * mean)));
+          for (int q = 0; q < 7; ++q) {
+            auto nth = x.begin() + static_cast<int>(Q[q] * (N - 1));
+            std::nth_element(x.begin(), nth, x.end());
+            rec[4 + q] = *nth;
+          }
+          const float lo = rec[9];
+          const float hi = (rec[10] > lo) ? rec[10] : lo + 1.f;
+          rec[10] = hi;     // the range actually binned
+          hist.reset(lo, hi, bins);
+          for (auto val : x) hist(val);
+          const auto counts = hist.bins();
+          std::copy(counts.cbegin(), counts.cend(), rec + 11);
+        }
+      }
+      oa_dst.insert(archive::compress(dst_.data(), V, R * sizeof(float), 0, method_));
     }
 
 
@@ -199,6 +342,27 @@ config$dir = getSrcDirectory(generation)[1]
     }
 
 
+    void stream_genealogy(const Genealogy& genealogy)
+    {
+      {
+        std::ofstream os;
+        os.open(folder / "agents_gen.bin", std::ios::out | std::ios::binary);
+        if (!os.is_open()) throw std::runtime_error("can't create agents_gen.bin");
+        for (const auto& node : genealogy.nodes()) {
+          int32_t val[3] = { node.gen, node.idx, node.parent };
+          os.write((const char*)val, sizeof(val));
+        }
+      }
+      {
+        std::ofstream os;
+        os.open(folder / "agents_tmrca.bin", std::ios::out | std::ios::binary);
+        if (!os.is_open()) throw std::runtime_error("can't create agents_tmrca.bin");
+        const auto& tmrca = genealogy.tmrca_history();
+        os.write((const char*)tmrca.data(), tmrca.size() * sizeof(int));
+      }
+    }
+
+
     void stream_meta(const Simulation* sim)
     {
       { // stream config
@@ -211,7 +375,10 @@ config$dir = getSrcDirectory(generation)[1]
         os << "config = list(\n";
         stream_parameter(os, sim->param(), "  ", ",\n", "c(", ")");
         os << "\n# Metadata\n";
-        os << "  agents.ann.weights = " << sim->agents().ann->state_size() << "\n";
+        os << "  agents.ann.weights = " << sim->agents().ann->state_size() << ",\n";
+        os << "  agents.strategy.cols = " << 4 + sim->agents().ann->input_size() + sim->agents().ann->state_size() << ",\n";
+        os << "  agents.dst.cols = " << 11 + sim->param().output.bins << ",\n";
+        os << "  agents.spatial.cols = " << 7 + std::min(sim->param().spatial.rmax, sim->landscape().dim() / 2) << "\n";
         os << ")\n";
         os << sourceMe;
       }
@@ -224,6 +391,9 @@ config$dir = getSrcDirectory(generation)[1]
         fs::create_directory(folder / "depends");
       }
       fs::copy(cur / "extract.exe", folder / "depends", fs::copy_options::overwrite_existing);
+      if (fs::exists(cur / "assay.exe")) {
+        fs::copy(cur / "assay.exe", folder / "depends", fs::copy_options::overwrite_existing);
+      }
     }
 
 	  fs::path folder;
@@ -232,6 +402,11 @@ config$dir = getSrcDirectory(generation)[1]
     archive::oarch oa_agents_anc_;
     archive::oarch oa_agents_foa_;
     archive::oarch oa_agents_han_;
+    archive::oarch oa_agents_dst_;
+    archive::method method_;        // output.codec
+    archive::method method_ann_;    // output.codec_ann
+    std::vector<float> dst_;
+    bool summary_ = false;
 
   };
 
@@ -0,0 +1,299 @@
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <zlib/zlib.h>
+#include "codec.hpp"
+
+
+namespace archive {
+
+
+  namespace {
+
+    // stored
+
+    size_t none_bound(size_t n) { return n; }
+
+
+    size_t none_encode(const unsigned char* src, size_t n, unsigned char* dst, size_t cap, int)
+    {
+      if (n > cap) return 0;
+      std::memcpy(dst, src, n);
+      return n;
+    }
+
+
+    bool none_decode(const unsigned char* src, size_t csize, unsigned char* dst, size_t n)
+    {
+      if (csize != n) return false;
+      std::memcpy(dst, src, n);
+      return true;
+    }
+
+
+    // zlib
+
+    size_t zlib_bound(size_t n) { return compressBound(static_cast<uLong>(n)); }
+
+
+    size_t zlib_encode(const unsigned char* src, size_t n, unsigned char* dst, size_t cap, int level)
+    {
+      uLong destLen = static_cast<uLong>(cap);
+      if (Z_OK != ::compress2(dst, &destLen, src, static_cast<uLong>(n), level ? level : Z_DEFAULT_COMPRESSION)) return 0;
+      return destLen;
+    }
+
+
+    bool zlib_decode(const unsigned char* src, size_t csize, unsigned char* dst, size_t n)
+    {
+      uLong destLen = static_cast<uLong>(n);
+      return (Z_OK == ::uncompress(dst, &destLen, src, static_cast<uLong>(csize))) && (destLen == n);
+    }
+
+
+    // LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md),
+    // greedy single-probe hash table, compatible with the reference decoder.
+
+    const size_t lz4_min_match = 4;
+    const size_t lz4_last_literals = 5;   // the last 5 bytes are always literals
+    const size_t lz4_mf_limit = 12;       // the last match starts at least 12 bytes before the end
+    const size_t lz4_max_distance = 65535;
+    const int lz4_hash_log = 16;
+
+
+    inline uint32_t read32(const unsigned char* p)
+    {
+      uint32_t x;
+      std::memcpy(&x, p, 4);
+      return x;
+    }
+
+
+    inline uint32_t lz4_hash(uint32_t x)
+    {
+      return (x * 2654435761u) >> (32 - lz4_hash_log);
+    }
+
+
+    inline unsigned char* lz4_length(unsigned char* op, size_t len)
+    {
+      for (; len >= 255; len -= 255) *op++ = 255;
+      *op++ = static_cast<unsigned char>(len);
+      return op;
+    }
+
+
+    size_t lz4_bound(size_t n) { return n + n / 255 + 16; }
+
+
+    size_t lz4_encode(const unsigned char* src, size_t n, unsigned char* dst, size_t cap, int)
+    {
+      if (cap < lz4_bound(n)) return 0;
+      unsigned char* op = dst;
+      size_t anchor = 0;
+
+      // emits literals [anchor, ip) followed by a match of length ml at distance offset (ml = 0: last literals)
+      auto sequence = [&](size_t ip, size_t offset, size_t ml) {
+        const size_t lit = ip - anchor;
+        unsigned char* token = op++;
+        *token = static_cast<unsigned char>(((lit >= 15) ? 15 : lit) << 4);
+        if (lit >= 15) op = lz4_length(op, lit - 15);
+        std::memcpy(op, src + anchor, lit);
+        op += lit;
+        if (ml) {
+          *op++ = static_cast<unsigned char>(offset);
+          *op++ = static_cast<unsigned char>(offset >> 8);
+          const size_t m = ml - lz4_min_match;
+          *token |= static_cast<unsigned char>((m >= 15) ? 15 : m);
+          if (m >= 15) op = lz4_length(op, m - 15);
+        }
+      };
+
+      if (n > lz4_mf_limit) {
+        std::vector<int64_t> table(size_t(1) << lz4_hash_log, -1);
+        const size_t mf_limit = n - lz4_mf_limit;
+        const size_t match_limit = n - lz4_last_literals;
+        size_t ip = 0;
+        while (ip <= mf_limit) {
+          const uint32_t seq = read32(src + ip);
+          const uint32_t h = lz4_hash(seq);
+          const int64_t ref = table[h];
+          table[h] = static_cast<int64_t>(ip);
+          if (ref >= 0 && ip - ref <= lz4_max_distance && read32(src + ref) == seq) {
+            size_t ml = lz4_min_match;
+            while (ip + ml < match_limit && src[ref + ml] == src[ip + ml]) ++ml;
+            sequence(ip, ip - ref, ml);
+            ip += ml;
+            anchor = ip;
+          }
+          else {
+            ip += 1 + ((ip - anchor) >> 6);   // skip faster through incompressible data
+          }
+        }
+      }
+      sequence(n, 0, 0);
+      return op - dst;
+    }
+
+
+    bool lz4_decode(const unsigned char* src, size_t csize, unsigned char* dst, size_t n)
+    {
+      const unsigned char* ip = src;
+      const unsigned char* const iend = src + csize;
+      size_t op = 0;
+      auto length = [&](size_t len) -> size_t {
+        if (len != 15) return len;
+        for (unsigned char b = 255; b == 255; len += b) {
+          if (ip == iend) return SIZE_MAX;
+          b = *ip++;
+        }
+        return len;
+      };
+      while (ip < iend) {
+        const unsigned char token = *ip++;
+        const size_t lit = length(token >> 4);
+        if (lit > size_t(iend - ip) || lit > n - op) return false;
+        std::memcpy(dst + op, ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == iend) break;    // last sequence
+        if (iend - ip < 2) return false;
+        const size_t offset = ip[0] | (size_t(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > op) return false;
+        const size_t ml = length(token & 15);
+        if (ml == SIZE_MAX || ml + lz4_min_match > n - op) return false;
+        for (size_t i = 0; i < ml + lz4_min_match; ++i, ++op) {
+          dst[op] = dst[op - offset];   // may overlap
+        }
+      }
+      return op == n;
+    }
+
+
+    const codec_info codecs[method::max_codec] = {
+      { "none", none_bound, none_encode, none_decode },
+      { "zlib", zlib_bound, zlib_encode, zlib_decode },
+      { "lz4", lz4_bound, lz4_encode, lz4_decode },
+    };
+
+
+    const char* filters[method::max_filter] = { "none", "shuffle", "split" };
+
+  }
+
+
+  method parse_method(const std::string& str)
+  {
+    method m;
+    std::string spec = str;
+    m.filter = method::nofilter;
+    const auto plus = spec.find('+');
+    if (plus != std::string::npos) {
+      const std::string f = spec.substr(0, plus);
+      spec = spec.substr(plus + 1);
+      int i = 0;
+      for (; i < method::max_filter && f != filters[i]; ++i);
+      if (i == method::max_filter) throw std::runtime_error("unknown archive filter '" + f + "'");
+      m.filter = static_cast<uint8_t>(i);
+    }
+    const auto colon = spec.find(':');
+    const std::string c = spec.substr(0, colon);
+    int i = 0;
+    for (; i < method::max_codec && c != codecs[i].name; ++i);
+    if (i == method::max_codec) throw std::runtime_error("unknown archive codec '" + c + "'");
+    m.codec = static_cast<uint8_t>(i);
+    m.level = 0;
+    if (colon != std::string::npos) {
+      const char* first = spec.c_str() + colon + 1;
+      char* last = nullptr;
+      const long level = std::strtol(first, &last, 10);
+      if (m.codec != method::zlib || last == first || *last != '\0' || level < 1 || level > 9) throw std::runtime_error("invalid archive codec level '" + str + "'");
+      m.level = static_cast<uint8_t>(level);
+    }
+    return m;
+  }
+
+
+  std::string to_string(const method& m)
+  {
+    std::string str;
+    if (m.filter != method::nofilter && m.filter < method::max_filter) str = std::string(filters[m.filter]) + "+";
+    str += (m.codec < method::max_codec) ? codecs[m.codec].name : "?";
+    if (m.level) str += ":" + std::to_string(m.level);
+    return str;
+  }
+
+
+  const codec_info& get_codec(uint8_t codec)
+  {
+    if (codec >= method::max_codec) throw std::runtime_error("unknown archive codec");
+    return codecs[codec];
+  }
+
+
+  void check_method(uint32_t codec, uint32_t filter)
+  {
+    if (codec >= method::max_codec) throw std::runtime_error("unknown archive codec");
+    if (filter >= method::max_filter) throw std::runtime_error("unknown archive filter");
+  }
+
+
+  void apply_filter(uint8_t filter, const unsigned char* src, size_t n, unsigned char* dst)
+  {
+    const size_t words = n / 4;
+    switch (filter) {
+      case method::nofilter:
+        std::memcpy(dst, src, n);
+        return;
+      case method::shuffle:
+        for (size_t i = 0; i < words; ++i) {
+          for (size_t k = 0; k < 4; ++k) dst[k * words + i] = src[4 * i + k];
+        }
+        break;
+      case method::split:
+        for (size_t i = 0; i < words; ++i) {
+          const uint32_t w = read32(src + 4 * i);
+          const uint32_t sm = (w & 0x7fffff) | ((w >> 31) << 23);
+          dst[i] = static_cast<unsigned char>(w >> 23);
+          dst[words + i] = static_cast<unsigned char>(sm >> 16);
+          dst[2 * words + i] = static_cast<unsigned char>(sm >> 8);
+          dst[3 * words + i] = static_cast<unsigned char>(sm);
+        }
+        break;
+      default:
+        throw std::runtime_error("unknown archive filter");
+    }
+    std::memcpy(dst + 4 * words, src + 4 * words, n - 4 * words);
+  }
+
+
+  void revert_filter(uint8_t filter, const unsigned char* src, size_t n, unsigned char* dst)
+  {
+    const size_t words = n / 4;
+    switch (filter) {
+      case method::nofilter:
+        std::memcpy(dst, src, n);
+        return;
+      case method::shuffle:
+        for (size_t i = 0; i < words; ++i) {
+          for (size_t k = 0; k < 4; ++k) dst[4 * i + k] = src[k * words + i];
+        }
+        break;
+      case method::split:
+        for (size_t i = 0; i < words; ++i) {
+          const uint32_t e = src[i];
+          const uint32_t sm = (uint32_t(src[words + i]) << 16) | (uint32_t(src[2 * words + i]) << 8) | src[3 * words + i];
+          const uint32_t w = ((sm >> 23) << 31) | ((e & 0xff) << 23) | (sm & 0x7fffff);
+          std::memcpy(dst + 4 * i, &w, 4);
+        }
+        break;
+      default:
+        throw std::runtime_error("unknown archive filter");
+    }
+    std::memcpy(dst + 4 * words, src + 4 * words, n - 4 * words);
+  }
+
+}
@@ -0,0 +1,66 @@
+#ifndef ARCHIVE_CODEC_HPP_INCLUDED
+#define ARCHIVE_CODEC_HPP_INCLUDED
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+namespace archive {
+
+
+  // Compression method of an archive entry: [filter+]codec[:level]
+  // e.g. "zlib", "zlib:9", "lz4", "shuffle+lz4", "split+zlib:1", "none"
+  struct method
+  {
+    enum codec_t : uint8_t {
+      none = 0,         // stored
+      zlib = 1,         // deflate, level 1..9, 0: zlib default
+      lz4 = 2,          // LZ4 block format, no level
+      max_codec
+    };
+
+    enum filter_t : uint8_t {
+      nofilter = 0,
+      shuffle = 1,      // byte planes of 4-byte words
+      split = 2,        // float32: exponent plane, then sign/mantissa planes
+      max_filter
+    };
+
+    uint8_t codec = zlib;
+    uint8_t level = 0;
+    uint8_t filter = nofilter;
+  };
+
+
+  // throws std::runtime_error on unknown codecs or filters
+  method parse_method(const std::string& str);
+  std::string to_string(const method& m);
+
+
+  // codec registry entry
+  struct codec_info
+  {
+    const char* name;
+    size_t (*bound)(size_t n);    // max. encoded size of n bytes
+    // returns encoded size, 0 on failure
+    size_t (*encode)(const unsigned char* src, size_t n, unsigned char* dst, size_t cap, int level);
+    // decodes exactly n bytes into dst
+    bool (*decode)(const unsigned char* src, size_t csize, unsigned char* dst, size_t n);
+  };
+
+  // throws std::runtime_error on unknown codecs
+  const codec_info& get_codec(uint8_t codec);
+
+  // throws std::runtime_error on unknown codecs or filters,
+  // codec: method::codec_t without the level
+  void check_method(uint32_t codec, uint32_t filter);
+
+
+  // filters work on 4-byte words, trailing bytes are copied as is
+  void apply_filter(uint8_t filter, const unsigned char* src, size_t n, unsigned char* dst);
+  void revert_filter(uint8_t filter, const unsigned char* src, size_t n, unsigned char* dst);
+
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <filesystem>
+#include "simulation.h"
+#include "conflict_log.h"
+
+
+namespace fs = std::filesystem;
+
+
+namespace cine2 {
+
+
+  namespace {
+
+    // Single writer thread, the producer only swaps buffers.
+    class AsyncWriter
+    {
+    public:
+      explicit AsyncWriter(const fs::path& file)
+      : done_(false)
+      {
+        fb_.open(file, std::ios::out | std::ios::binary);
+        if (!fb_.is_open()) throw std::runtime_error("can't create conflicts.bin");
+        thread_ = std::thread([this]() { run(); });
+      }
+
+      ~AsyncWriter()
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          done_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+        fb_.close();
+      }
+
+      void push(std::vector<char>&& buf)
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          queue_.emplace_back(std::move(buf));
+        }
+        cv_.notify_one();
+      }
+
+    private:
+      void run()
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+          cv_.wait(lock, [this]() { return done_ || !queue_.empty(); });
+          while (!queue_.empty()) {
+            auto buf = std::move(queue_.front());
+            queue_.pop_front();
+            lock.unlock();
+            fb_.sputn(buf.data(), buf.size());
+            lock.lock();
+          }
+          if (done_) return;
+        }
+      }
+
+      bool done_;
+      std::filebuf fb_;
+      std::mutex mutex_;
+      std::condition_variable cv_;
+      std::deque<std::vector<char>> queue_;
+      std::thread thread_;
+    };
+
+  }
+
+
+  class ConflictLogObserver : public Observer
+  {
+    static const size_t flush_size = 1 << 20;
+
+  public:
+    explicit ConflictLogObserver(const fs::path& path)
+    : Observer(),
+      folder(path)
+    {
+    }
+
+    ~ConflictLogObserver() override
+    {
+    }
+
+    // required observer interface
+    bool notify(void* userdata, long long msg) override
+    {
+      auto sim = reinterpret_cast<const Simulation*>(userdata);
+      using msg_type = Simulation::msg_type;
+
+      switch (msg) {
+        case msg_type::INITIALIZED: {
+          writer_.reset(new AsyncWriter(folder / "conflicts.bin"));
+          const uint32_t header[2] = { conflict_log::magic, conflict_log::version };
+          buf_.insert(buf_.end(), (const char*)header, (const char*)header + sizeof(header));
+          break;
+        }
+        case msg_type::POST_TIMESTEP:
+          if (!sim->conflict_events().empty()) {
+            events_ = sim->conflict_events();
+            encoder_.encode(buf_, sim->generation(), sim->timestep(), events_);
+            if (buf_.size() >= flush_size) flush();
+          }
+          break;
+        case msg_type::FINISHED:
+          flush();
+          writer_.reset();    // joins
+          break;
+      }
+      return notify_next(userdata, msg);
+    };
+
+  private:
+    void flush()
+    {
+      if (buf_.empty() || !writer_) return;
+      writer_->push(std::move(buf_));
+      buf_ = std::vector<char>();
+      buf_.reserve(flush_size + 4096);
+    }
+
+    fs::path folder;
+    std::unique_ptr<AsyncWriter> writer_;
+    conflict_log::Encoder encoder_;
+    std::vector<ConflictEvent> events_;
+    std::vector<char> buf_;
+  };
+
+
+  std::unique_ptr<Observer> CreateConflictLogObserver(const std::string& folder)
+  {
+    fs::path path(folder);
+    fs::create_directory(path);
+    return std::unique_ptr<Observer>(new ConflictLogObserver(path));
+  }
+
+}
@@ -0,0 +1,143 @@
+#ifndef CINE2_CONFLICT_LOG_H_INCLUDED
+#define CINE2_CONFLICT_LOG_H_INCLUDED
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+#include <cine/observer.h>
+
+
+namespace cine2 {
+
+
+  struct ConflictEvent
+  {
+    int cell;         // y * dim + x of the attacker before resolution
+    int attacker;     // index into the population
+    int victim;       // index into the population
+    int outcome;      // 1: attacker won, 0: attacker fled
+  };
+
+
+  namespace conflict_log {
+
+    // file layout:
+    //   magic 'KCEV', uint32 version
+    //   blocks: varint(g - last_g), varint(t or t - last_t), varint(n)
+    //           n x { varint(dcell << 1 | outcome), varint(attacker), varint(zigzag(victim - attacker)) }
+    //   events within a block are sorted by cell, dcell is the difference to the previous cell.
+    const uint32_t magic = 0x5645434b;    // little endian ascii: 'KCEV'
+    const uint32_t version = 1;
+
+
+    inline uint64_t splitmix64(uint64_t x)
+    {
+      x += 0x9e3779b97f4a7c15ull;
+      x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+      x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+      return x ^ (x >> 31);
+    }
+
+
+    // deterministic sampling: doesn't touch the simulation's random streams
+    inline bool sampled(float p, int g, int t, int attacker)
+    {
+      if (p >= 1.f) return true;
+      const uint64_t h = splitmix64((uint64_t(uint32_t(g)) << 40) ^ (uint64_t(uint32_t(t)) << 24) ^ uint64_t(uint32_t(attacker)));
+      return (h >> 11) * (1.0 / 9007199254740992.0) < p;
+    }
+
+
+    inline void put_varint(std::vector<char>& buf, uint64_t x)
+    {
+      while (x >= 0x80) {
+        buf.push_back(static_cast<char>((x & 0x7f) | 0x80));
+        x >>= 7;
+      }
+      buf.push_back(static_cast<char>(x));
+    }
+
+
+    inline uint64_t get_varint(const char*& p, const char* end)
+    {
+      uint64_t x = 0;
+      for (int shift = 0; p != end; shift += 7) {
+        const uint8_t b = static_cast<uint8_t>(*p++);
+        x |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) return x;
+      }
+      throw std::runtime_error("conflict_log: truncated varint");
+    }
+
+
+    inline uint64_t zigzag(int64_t x) { return (uint64_t(x) << 1) ^ uint64_t(x >> 63); }
+    inline int64_t unzigzag(uint64_t x) { return int64_t(x >> 1) ^ -int64_t(x & 1); }
+
+
+    // Appends one timestep block. events are sorted in place.
+    class Encoder
+    {
+    public:
+      void encode(std::vector<char>& buf, int g, int t, std::vector<ConflictEvent>& events)
+      {
+        std::sort(events.begin(), events.end(), [](const auto& a, const auto& b) {
+          return (a.cell < b.cell) || (a.cell == b.cell && a.attacker < b.attacker);
+        });
+        put_varint(buf, uint64_t(g - last_g_));
+        put_varint(buf, uint64_t((g == last_g_) ? t - last_t_ : t));
+        put_varint(buf, events.size());
+        int cell = 0;
+        for (const auto& e : events) {
+          put_varint(buf, (uint64_t(e.cell - cell) << 1) | uint64_t(e.outcome & 1));
+          put_varint(buf, uint64_t(e.attacker));
+          put_varint(buf, zigzag(int64_t(e.victim) - e.attacker));
+          cell = e.cell;
+        }
+        last_g_ = g;
+        last_t_ = t;
+      }
+
+    private:
+      int last_g_ = 0;
+      int last_t_ = 0;
+    };
+
+
+    // Decodes the payload (after magic and version) into
+    // {g, t, cell, attacker, victim, outcome} rows.
+    inline std::vector<std::array<int, 6>> decode(const char* p, const char* end)
+    {
+      std::vector<std::array<int, 6>> rows;
+      int g = 0, t = 0;
+      while (p != end) {
+        const int dg = static_cast<int>(get_varint(p, end));
+        const int dt = static_cast<int>(get_varint(p, end));
+        t = (dg == 0) ? t + dt : dt;
+        g += dg;
+        const size_t n = get_varint(p, end);
+        int cell = 0;
+        for (size_t i = 0; i < n; ++i) {
+          const uint64_t c = get_varint(p, end);
+          cell += static_cast<int>(c >> 1);
+          const int attacker = static_cast<int>(get_varint(p, end));
+          const int victim = static_cast<int>(attacker + unzigzag(get_varint(p, end)));
+          rows.push_back({ g, t, cell, attacker, victim, static_cast<int>(c & 1) });
+        }
+      }
+      return rows;
+    }
+
+  }
+
+
+  // Streams the conflict events of every timestep into conflicts.bin.
+  // Encoding happens on the simulation thread, file output asynchronously.
+  std::unique_ptr<class Observer> CreateConflictLogObserver(const std::string& folder);
+
+}
+
+
+#endif
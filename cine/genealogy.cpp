@@ -0,0 +1,71 @@
+#include <algorithm>
+#include "genealogy.h"
+
+
+namespace cine2 {
+
+
+  void Genealogy::add_generation(int g, const std::vector<Individual>& pop)
+  {
+    const int N = static_cast<int>(pop.size());
+    const int prev_samples = first_sample_;
+    const bool first = nodes_.empty();
+    first_sample_ = static_cast<int>(nodes_.size());
+    nodes_.reserve(nodes_.size() + N);
+    for (int i = 0; i < N; ++i) {
+      const int parent = first ? -1 : prev_samples + pop[i].ancestor;
+      nodes_.push_back({ parent, g, i });
+    }
+    g_ = g;
+    simplify();
+    tmrca_.push_back(tmrca());
+  }
+
+
+  int Genealogy::tmrca() const
+  {
+    if (roots_ != 1) return -1;
+    return g_ - nodes_[0].gen;    // the root comes first
+  }
+
+
+  // Nodes are stored in order of birth, parents precede their children.
+  void Genealogy::simplify()
+  {
+    const int M = static_cast<int>(nodes_.size());
+    const int S = first_sample_;
+
+    // count surviving child lineages, walking from the samples upwards
+    // branches_[n] < 0 marks nodes without surviving descendants
+    branches_.assign(M, -1);
+    for (int n = S; n < M; ++n) branches_[n] = 0;
+    for (int n = M - 1; n >= 0; --n) {
+      const int parent = nodes_[n].parent;
+      if (branches_[n] >= 0 && parent >= 0) {
+        branches_[parent] = std::max(branches_[parent], 0) + 1;
+      }
+    }
+
+    // remap_[n]: nearest kept node at or above n, -1 if none
+    remap_.assign(M, -1);
+    int kept = 0;
+    roots_ = 0;
+    for (int n = 0; n < M; ++n) {
+      if (branches_[n] < 0) continue;
+      const int parent = nodes_[n].parent;
+      const int above = (parent >= 0) ? remap_[parent] : -1;
+      if (n >= S || branches_[n] >= 2) {
+        const Node node = nodes_[n];
+        nodes_[kept] = { above, node.gen, node.idx };
+        if (above < 0) ++roots_;
+        remap_[n] = kept++;
+      }
+      else {
+        remap_[n] = above;
+      }
+    }
+    nodes_.resize(kept);
+    first_sample_ = kept - (M - S);
+  }
+
+}
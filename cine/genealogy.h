@@ -0,0 +1,54 @@
+#ifndef CINE2_GENEALOGY_H_INCLUDED
+#define CINE2_GENEALOGY_H_INCLUDED
+
+#include <vector>
+#include "individuals.h"
+
+
+namespace cine2 {
+
+
+  // Pruned genealogy of the population.
+  //
+  // Holds the nodes that are ancestral to the current generation and are
+  // either samples (current generation) or coalescent (two or more surviving
+  // child lineages). Extinct lineages and unary nodes are simplified away
+  // after every generation, thus the table stays below 2N nodes.
+  class Genealogy
+  {
+  public:
+    struct Node
+    {
+      int parent;   // index into nodes(), -1 for roots
+      int gen;      // generation of birth
+      int idx;      // index into the population of generation gen
+    };
+
+  public:
+    Genealogy() : g_(-1), first_sample_(0), roots_(0) {}
+
+    // adds generation g, the ancestor field indexes the previous generation
+    void add_generation(int g, const std::vector<Individual>& pop);
+
+    // generations to the most recent common ancestor, -1 if not coalesced
+    int tmrca() const;
+
+    int roots() const { return roots_; }
+    const std::vector<Node>& nodes() const { return nodes_; }
+    const std::vector<int>& tmrca_history() const { return tmrca_; }
+
+  private:
+    void simplify();
+
+    int g_;
+    int first_sample_;      // first node of the current generation
+    int roots_;
+    std::vector<Node> nodes_;
+    std::vector<int> tmrca_;
+    std::vector<int> branches_;   // scratch
+    std::vector<int> remap_;      // scratch
+  };
+
+}
+
+#endif
@@ -40,8 +40,9 @@ namespace cine2 {
     const int n = dst.size();
     float* pdst = dst.data();
     const unsigned* psrc = src.data();
-    for (int i=0; i<n; ++i, ++pdst, ++psrc) {
-      *pdst = static_cast<float>(select_channel(*psrc)) / 255.0f;
+#   pragma omp parallel for schedule(static)
+    for (int i=0; i<n; ++i) {
+      pdst[i] = static_cast<float>(select_channel(psrc[i])) / 255.0f;
     }
   }
 
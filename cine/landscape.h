@@ -4,6 +4,9 @@
 #include <cassert>
 #include <cstring>      // memset
 #include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <utility>
 #include <xmmintrin.h>
 #include "convolution.h"
 #include "ann.hpp"      // ann_assume_aligned
@@ -109,6 +112,12 @@ namespace cine2 {
   ///        
   /// A Landscape represents a quadradic (POT) area composed of
   /// several layers.
+  ///
+  /// Storage is dense, but the area is partitioned into tiles of tile() x tile()
+  /// cells. The landscape tracks which tiles may hold non-zero values:
+  /// habitat tiles (capacity > 0), tiles occupied by the last update_occupancy
+  /// and tiles recorded since the last restart_records. Passes over a layer
+  /// only need to visit live_tiles(layer); all other cells are zero.
   class Landscape
   {
   public:
@@ -143,8 +152,17 @@ namespace cine2 {
 
     Landscape& operator=(Landscape&& rhs) noexcept
     {
-      dim_ = rhs.dim_; rhs.dim_ = 0;
-      data_ = rhs.data_; rhs.data_ = nullptr;
+      std::swap(dim_, rhs.dim_);
+      std::swap(data_, rhs.data_);
+      std::swap(tile_, rhs.tile_);
+      std::swap(tiles_, rhs.tiles_);
+      std::swap(shift_, rhs.shift_);
+      std::swap(tiles_shift_, rhs.tiles_shift_);
+      all_.swap(rhs.all_);
+      habitat_.swap(rhs.habitat_);
+      occupied_.swap(rhs.occupied_);
+      recorded_.swap(rhs.recorded_);
+      tile_flags_.swap(rhs.tile_flags_);
       return *this;
     }
 
@@ -162,12 +180,26 @@ namespace cine2 {
       data_ = (float*)_mm_malloc(Layers::max_layer * dim * dim * sizeof(float), 64);
       if (data_ == nullptr) throw std::bad_alloc();
       dim_ = dim;
-      std::memset(data_, 0, mem_size());
+      // first touch in parallel
+#     pragma omp parallel for schedule(static)
+      for (int l = 0; l < Layers::max_layer; ++l) {
+        std::memset(data_ + static_cast<size_t>(l) * dim * dim, 0, layer_mem_size());
+      }
+      set_tiles(0);
     }
 
     Landscape(const Landscape& rhs) : Landscape(rhs.dim_)
     {
       std::memcpy(data_, rhs.data_, mem_size());
+      tile_ = rhs.tile_;
+      tiles_ = rhs.tiles_;
+      shift_ = rhs.shift_;
+      tiles_shift_ = rhs.tiles_shift_;
+      all_ = rhs.all_;
+      habitat_ = rhs.habitat_;
+      occupied_ = rhs.occupied_;
+      recorded_ = rhs.recorded_;
+      tile_flags_ = rhs.tile_flags_;
     }
     
     Landscape& operator=(const Landscape& rhs)
@@ -192,6 +224,149 @@ namespace cine2 {
     /// \return the size of a layers in memory [bytes].
     int layer_mem_size() const { return dim_ * dim_ * sizeof(float); }
 
+    /// \brief  Partitions the landscape into tiles and collects the habitat tiles
+    ///         from the capacity layer, call after loading it.
+    ///
+    /// \exception  std::runtime_error  Raised when tile is not POT or exceeds dim.
+    ///
+    /// \param  tile The tile side length, 0: a single tile (dense passes).
+    void set_tiles(int tile)
+    {
+      tile = tile ? tile : dim_;
+      if ((tile & (tile - 1)) != 0 || tile < 4 || tile > dim_) {
+        throw std::runtime_error("Landscape tile shall be POT in [4, dim]");
+      }
+      tile_ = tile;
+      tiles_ = dim_ / tile;
+      for (shift_ = 0; (1 << shift_) < tile_; ++shift_);
+      for (tiles_shift_ = 0; (1 << tiles_shift_) < tiles_; ++tiles_shift_);
+      all_.resize(tiles_ * tiles_);
+      for (int t = 0; t < tiles_ * tiles_; ++t) all_[t] = t;
+      occupied_ = recorded_ = all_;     // unknown content
+      tile_flags_.assign(tiles_ * tiles_, occupied_flag | recorded_flag);
+      habitat_.clear();
+      if (tiles_ == 1) {
+        habitat_ = all_;    // dense
+        return;
+      }
+      const float* capacity = data_ + Layers::capacity * dim_ * dim_;
+      for (int t : all_) {
+        bool live = false;
+        for_each_cell(t, [&](int i) { live = live || (capacity[i] > 0.f); });
+        if (live) habitat_.push_back(t);
+      }
+    }
+
+    /// \return the tile side length.
+    int tile() const { return tile_; }
+
+    /// \return the tiles that may hold non-zero values in layer.
+    const std::vector<int>& live_tiles(Layers layer) const
+    {
+      switch (layer) {
+        case capacity:
+        case items:
+        case items_rec:
+          return habitat_;
+        case foragers:
+        case klepts:
+        case handlers:
+        case foragers_count:
+        case klepts_count:
+        case handlers_count:
+        case nonhandlers:
+          return occupied_;
+        case foragers_rec:
+        case klepts_rec:
+        case foragers_intake:
+        case klepts_intake:
+          return recorded_;
+        default:
+          return all_;
+      }
+    }
+
+    /// \brief  Calls fun(i) for every cell index i = dim * y + x of tile t, row by row.
+    template <typename Fun>
+    void for_each_cell(int t, Fun&& fun) const
+    {
+      const int x0 = (t & (tiles_ - 1)) << shift_;
+      const int y0 = (t >> tiles_shift_) << shift_;
+      for (int y = y0; y < y0 + tile_; ++y) {
+        const int row = dim_ * y;
+        for (int x = x0; x < x0 + tile_; ++x) {
+          fun(row + x);
+        }
+      }
+    }
+
+    /// \brief  Calls fun(first, n) for the runs of cells [first, first + n) the listed
+    ///         tiles cover, in row-major order. Horizontally adjacent tiles form one run.
+    ///
+    /// \param  tiles Ascending tile indices.
+    template <typename Fun>
+    void for_each_run(const std::vector<int>& tiles, Fun&& fun) const
+    {
+      for_each_run(tiles, 0, dim_, std::forward<Fun>(fun));
+    }
+
+    /// \brief  As above, restricted to the rows [y0, y1).
+    template <typename Fun>
+    void for_each_run(const std::vector<int>& tiles, int y0, int y1, Fun&& fun) const
+    {
+      const size_t n = tiles.size();
+      size_t i = std::lower_bound(tiles.begin(), tiles.end(), (y0 >> shift_) << tiles_shift_) - tiles.begin();
+      while (i < n) {
+        // [i, j): the tiles of one tile row
+        const int ty = tiles[i] >> tiles_shift_;
+        if ((ty << shift_) >= y1) break;
+        size_t j = i + 1;
+        while (j < n && (tiles[j] >> tiles_shift_) == ty) ++j;
+        const int ya = std::max(ty << shift_, y0);
+        const int yb = std::min((ty + 1) << shift_, y1);
+        for (int y = ya; y < yb; ++y) {
+          for (size_t k = i; k < j; ) {
+            size_t e = k + 1;
+            while (e < j && tiles[e] == tiles[e - 1] + 1) ++e;
+            fun(dim_ * y + ((tiles[k] & (tiles_ - 1)) << shift_), static_cast<int>(e - k) << shift_);
+            k = e;
+          }
+        }
+        i = j;
+      }
+    }
+
+    /// \brief  Calls fun(i) for every cell index of the listed tiles, in row-major order.
+    template <typename Fun>
+    void for_each_cell(const std::vector<int>& tiles, Fun&& fun) const
+    {
+      for_each_cell(tiles, 0, dim_, std::forward<Fun>(fun));
+    }
+
+    /// \brief  As above, restricted to the rows [y0, y1).
+    template <typename Fun>
+    void for_each_cell(const std::vector<int>& tiles, int y0, int y1, Fun&& fun) const
+    {
+      for_each_run(tiles, y0, y1, [&](int first, int n) {
+        for (int i = first; i < first + n; ++i) fun(i);
+      });
+    }
+
+    /// \brief  Zeros the live tiles of layer.
+    void clear(Layers layer)
+    {
+      clear_tiles(data_ + layer * dim_ * dim_, live_tiles(layer));
+    }
+
+    /// \brief  Starts a new recording period of foragers_rec, klepts_rec and
+    ///         the intake layers, clear them before.
+    void restart_records()
+    {
+      for (int t : recorded_) tile_flags_[t] &= ~recorded_flag;
+      recorded_.clear();
+      mark_recorded();
+    }
+
     Coordinate wrap(Coordinate coor) const
     {
       const unsigned mask = dim_ - 1;
@@ -232,42 +407,95 @@ namespace cine2 {
       //Layers::foragers_count, Layers::foragers, Layers::klepts_count, Layers::klepts, Layers::handlers_count, Layers::handlers, Layers::nonhandlers,
 
 	  //clearing the vectors before the visualization of the current timestep
-      vforagers_count.clear();
-      vforagers.clear();
-      vklepts_count.clear();
-      vklepts.clear();
-      vhandlers_count.clear();
-      vhandlers.clear();
-      vnonhandlers.clear();
+      LayerView* views[] = { &vforagers_count, &vforagers, &vklepts_count, &vklepts, &vhandlers_count, &vhandlers, &vnonhandlers };
+#     pragma omp parallel for schedule(static)
+      for (int l = 0; l < 7; ++l) {
+        clear_tiles(views[l]->data(), occupied_);
+      }
+      for (int t : occupied_) tile_flags_[t] &= ~occupied_flag;
+      occupied_.clear();
+      const short r = Kernel::k / 2;
 
       for (; first != last; ++first) {		//cycle trough the agents
         if (first->alive()) {				//if alive
-          if (first->handle()) {				//and handling
-            ++vhandlers_count(first->pos);					//position stored in the vector3 (for handlers apparently)
-            vhandlers.stamp_kernel<Kernel::k>(first->pos, kernel.K);
-
-            if (first->foraging) {
-              ++vforagers_count(first->pos);  
-            }
-            else {
-              ++vklepts_count(first->pos);
+          // the kernel footprint touches at most the tiles of its corners
+          mark_occupied(first->pos + Coordinate(-r, -r));
+          mark_occupied(first->pos + Coordinate(r, -r));
+          mark_occupied(first->pos + Coordinate(-r, r));
+          mark_occupied(first->pos + Coordinate(r, r));
+          stamp(*first, views, kernel);
+        }
+      }
+      std::sort(occupied_.begin(), occupied_.end());
+      mark_recorded();
+    }
 
-            }
-          }
-          else if (first->foraging) {			//if not handling, but foraging
-            ++vforagers_count(first->pos);					//position stored in vector1 (for foragers)
-            vforagers.stamp_kernel<Kernel::k>(first->pos, kernel.K);
-            vnonhandlers.stamp_kernel<Kernel::k>(first->pos, kernel.K);
+    /// \brief  Owner-computes variant of update_occupancy.
+    ///
+    /// Every band of owners is cleared and stamped by one thread from the
+    /// agents it owns. Agents whose kernel reaches into a neighbouring band
+    /// are stamped in a serial second phase. Kernel sums are accumulated in
+    /// a different order than above, results may differ in the last bits.
+    template <typename Pop, typename Owners, typename Kernel>
+    void update_occupancy_owned(Layers foragers_count, Layers foragers, Layers klepts_count, Layers klepts, Layers handlers_count, Layers handlers, Layers nonhandlers, const Pop& pop, const Owners& owners, const Kernel& kernel)
+    {
+      LayerView vforagers_count = get_layer(foragers_count);
+      LayerView vforagers = get_layer(foragers);
+      LayerView vklepts_count = get_layer(klepts_count);
+      LayerView vklepts = get_layer(klepts);
+      LayerView vhandlers_count = get_layer(handlers_count);
+      LayerView vhandlers = get_layer(handlers);
+      LayerView vnonhandlers = get_layer(nonhandlers);
+      LayerView* views[] = { &vforagers_count, &vforagers, &vklepts_count, &vklepts, &vhandlers_count, &vhandlers, &vnonhandlers };
+      const short r = Kernel::k / 2;
+      const int B = owners.bands();
+      const int T = tiles_ * tiles_;
+      band_marks_.assign(size_t(B) * T, 0);
+      band_boundary_.resize(B);
+
+      owners.for_each_band([&](int b) {
+        const int y0 = owners.row_begin(b);
+        const int y1 = owners.row_end(b);
+        for (auto* view : views) {
+          float* layer = view->data();
+          for_each_run(occupied_, y0, y1, [=](int first, int n) {
+            std::memset(layer + first, 0, n * sizeof(float));
+          });
+        }
+        char* marks = band_marks_.data() + size_t(b) * T;
+        auto& boundary = band_boundary_[b];
+        boundary.clear();
+        for (auto it = owners.begin(b); it != owners.end(b); ++it) {
+          const auto& ind = pop[*it];
+          if (!ind.alive()) continue;
+          marks[tile_of(ind.pos + Coordinate(-r, -r))] = 1;
+          marks[tile_of(ind.pos + Coordinate(r, -r))] = 1;
+          marks[tile_of(ind.pos + Coordinate(-r, r))] = 1;
+          marks[tile_of(ind.pos + Coordinate(r, r))] = 1;
+          if (owners.interior(ind.pos.y, r)) {
+            stamp(ind, views, kernel);
           }
-          else {								//if not handling and not foragers (they are kleptoparasytes)
-            ++vklepts_count(first->pos);					//position stored in vector2 (for klepts)
-            vklepts.stamp_kernel<Kernel::k>(first->pos, kernel.K);
-            vnonhandlers.stamp_kernel<Kernel::k>(first->pos, kernel.K);
-
+          else {
+            boundary.push_back(*it);
           }
+        }
+      });
 
+      // second phase: stamps crossing band boundaries
+      for (const auto& boundary : band_boundary_) {
+        for (int i : boundary) stamp(pop[i], views, kernel);
+      }
+      for (int t : occupied_) tile_flags_[t] &= ~occupied_flag;
+      occupied_.clear();
+      for (int t = 0; t < T; ++t) {
+        char m = 0;
+        for (int b = 0; b < B; ++b) m |= band_marks_[size_t(b) * T + t];
+        if (m) {
+          tile_flags_[t] |= occupied_flag;
+          occupied_.push_back(t);
         }
       }
+      mark_recorded();
     }
 
 
@@ -275,8 +503,99 @@ namespace cine2 {
     const float* data() const { return data_; }
 
   private:
+    enum tile_flag : char {
+      occupied_flag = 1,
+      recorded_flag = 2,
+    };
+
+    // stamps one agent into { foragers_count, foragers, klepts_count, klepts, handlers_count, handlers, nonhandlers }
+    template <typename Ind, typename Kernel>
+    static void stamp(const Ind& ind, LayerView* const* views, const Kernel& kernel)
+    {
+      LayerView& vforagers_count = *views[0];
+      LayerView& vforagers = *views[1];
+      LayerView& vklepts_count = *views[2];
+      LayerView& vklepts = *views[3];
+      LayerView& vhandlers_count = *views[4];
+      LayerView& vhandlers = *views[5];
+      LayerView& vnonhandlers = *views[6];
+      if (ind.handle()) {				//and handling
+        ++vhandlers_count(ind.pos);					//position stored in the vector3 (for handlers apparently)
+        vhandlers.stamp_kernel<Kernel::k>(ind.pos, kernel.K);
+
+        if (ind.foraging) {
+          ++vforagers_count(ind.pos);  
+        }
+        else {
+          ++vklepts_count(ind.pos);
+
+        }
+      }
+      else if (ind.foraging) {			//if not handling, but foraging
+        ++vforagers_count(ind.pos);					//position stored in vector1 (for foragers)
+        vforagers.stamp_kernel<Kernel::k>(ind.pos, kernel.K);
+        vnonhandlers.stamp_kernel<Kernel::k>(ind.pos, kernel.K);
+      }
+      else {								//if not handling and not foragers (they are kleptoparasytes)
+        ++vklepts_count(ind.pos);					//position stored in vector2 (for klepts)
+        vklepts.stamp_kernel<Kernel::k>(ind.pos, kernel.K);
+        vnonhandlers.stamp_kernel<Kernel::k>(ind.pos, kernel.K);
+
+      }
+    }
+
+    int tile_of(Coordinate coor) const
+    {
+      coor = wrap(coor);
+      return ((coor.y >> shift_) << tiles_shift_) | (coor.x >> shift_);
+    }
+
+    void mark_occupied(Coordinate coor)
+    {
+      const int t = tile_of(coor);
+      if (!(tile_flags_[t] & occupied_flag)) {
+        tile_flags_[t] |= occupied_flag;
+        occupied_.push_back(t);
+      }
+    }
+
+    // adds the occupied tiles to the recorded tiles
+    void mark_recorded()
+    {
+      const size_t n = recorded_.size();
+      for (int t : occupied_) {
+        if (!(tile_flags_[t] & recorded_flag)) {
+          tile_flags_[t] |= recorded_flag;
+          recorded_.push_back(t);
+        }
+      }
+      if (recorded_.size() != n) std::sort(recorded_.begin(), recorded_.end());
+    }
+
+    void clear_tiles(float* layer, const std::vector<int>& tiles) const
+    {
+      if (tiles.size() == all_.size()) {
+        std::memset(layer, 0, layer_mem_size());
+        return;
+      }
+      for_each_run(tiles, [=](int first, int n) {
+        std::memset(layer + first, 0, n * sizeof(float));
+      });
+    }
+
     int dim_;
     float* data_;
+    int tile_ = 0;
+    int tiles_ = 0;                 // tiles per side
+    int shift_ = 0;                 // log2(tile_)
+    int tiles_shift_ = 0;           // log2(tiles_)
+    std::vector<int> all_;          // all tiles
+    std::vector<int> habitat_;      // tiles with capacity > 0
+    std::vector<int> occupied_;     // tiles touched by the last update_occupancy
+    std::vector<int> recorded_;     // tiles occupied since restart_records
+    std::vector<char> tile_flags_;  // per tile: tile_flag
+    std::vector<char> band_marks_;  // owner-computes scratch: occupied tiles per band
+    std::vector<std::vector<int>> band_boundary_;   // owner-computes scratch: deferred stamps per band
   };
 
 }
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include "mapped_memory.h"
+
+#ifdef _WIN32
+#  define NOMINMAX
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#endif
+
+
+namespace fs = std::filesystem;
+
+
+namespace cine2 {
+
+
+  namespace {
+
+    fs::path unique_file(const fs::path& folder)
+    {
+      static std::atomic<unsigned> counter{ 0 };
+      const auto ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+      return folder / ("ann_" + std::to_string(ticks) + "_" + std::to_string(counter++) + ".tmp");
+    }
+
+
+    size_t page_size()
+    {
+#ifdef _WIN32
+      SYSTEM_INFO si;
+      GetSystemInfo(&si);
+      return si.dwAllocationGranularity;
+#else
+      return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+  }
+
+
+  mapped_memory::mapped_memory(const fs::path& folder, size_t bytes)
+  : size_(bytes)
+  {
+    fs::create_directories(folder);
+    const auto file = unique_file(folder);
+#ifdef _WIN32
+    HANDLE hf = CreateFileW(file.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_NEW,
+                            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (hf == INVALID_HANDLE_VALUE) throw std::runtime_error("can't create mapped ann store");
+    HANDLE hm = CreateFileMappingW(hf, nullptr, PAGE_READWRITE, DWORD(uint64_t(bytes) >> 32), DWORD(bytes), nullptr);
+    if (hm == nullptr) {
+      CloseHandle(hf);
+      throw std::runtime_error("can't map ann store");
+    }
+    data_ = MapViewOfFile(hm, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    CloseHandle(hm);    // kept alive by the view
+    if (data_ == nullptr) {
+      CloseHandle(hf);
+      throw std::runtime_error("can't map ann store");
+    }
+    handle_ = hf;
+#else
+    const int fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) throw std::runtime_error("can't create mapped ann store");
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+      ::close(fd);
+      ::unlink(file.c_str());
+      throw std::runtime_error("can't resize mapped ann store");
+    }
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    ::unlink(file.c_str());
+    if (p == MAP_FAILED) throw std::runtime_error("can't map ann store");
+    data_ = p;
+#endif
+    advise(0, size_, sequential);
+  }
+
+
+  mapped_memory::~mapped_memory()
+  {
+#ifdef _WIN32
+    if (data_) UnmapViewOfFile(data_);
+    if (handle_) CloseHandle(static_cast<HANDLE>(handle_));
+#else
+    if (data_) ::munmap(data_, size_);
+#endif
+  }
+
+
+  void mapped_memory::advise(size_t offset, size_t len, advice a) const
+  {
+    if (offset >= size_) return;
+    len = std::min(len, size_ - offset);
+    // align to page boundary
+    const size_t ps = page_size();
+    const size_t begin = offset - offset % ps;
+    len += offset - begin;
+    char* p = static_cast<char*>(data_) + begin;
+#ifdef _WIN32
+    if (a == willneed) {
+      WIN32_MEMORY_RANGE_ENTRY range{ p, len };
+      PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#else
+    const int adv[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_WILLNEED };
+    ::madvise(p, len, adv[a]);
+#endif
+  }
+
+}
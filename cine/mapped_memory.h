@@ -0,0 +1,44 @@
+#ifndef CINE2_MAPPED_MEMORY_H_INCLUDED
+#define CINE2_MAPPED_MEMORY_H_INCLUDED
+
+#include <cstddef>
+#include <filesystem>
+
+
+namespace cine2 {
+
+
+  // Zero-initialized memory backed by a temporary file in 'folder'.
+  // The file is removed when the mapping is released (on POSIX as soon
+  // as it is mapped), the page cache decides what stays resident.
+  class mapped_memory
+  {
+  public:
+    enum advice {
+      normal,
+      sequential,     // aggressive read-ahead, pages behind are dropped early
+      willneed,       // start reading now
+    };
+
+    mapped_memory(const std::filesystem::path& folder, size_t bytes);
+    ~mapped_memory();
+
+    mapped_memory(const mapped_memory&) = delete;
+    mapped_memory& operator=(const mapped_memory&) = delete;
+
+    void* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // access hint for [offset, offset + len), clipped to the mapping
+    void advise(size_t offset, size_t len, advice a) const;
+
+  private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    void* handle_ = nullptr;    // file handle (Windows only)
+  };
+
+}
+
+
+#endif
@@ -0,0 +1,208 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include "simulation.h"
+#include "metrics.h"
+#include "archive.hpp"
+
+#ifdef _WIN32
+#  define NOMINMAX
+#  include <windows.h>
+#  include <psapi.h>
+#  pragma comment(lib, "psapi.lib")
+#else
+#  include <unistd.h>
+#endif
+
+
+namespace fs = std::filesystem;
+
+
+namespace cine2 {
+
+
+  namespace {
+
+    // resident set size [bytes], 0 if unknown
+    uint64_t resident_memory()
+    {
+#ifdef _WIN32
+      PROCESS_MEMORY_COUNTERS pmc;
+      if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return static_cast<uint64_t>(pmc.WorkingSetSize);
+      }
+      return 0;
+#else
+      std::ifstream is("/proc/self/statm");
+      uint64_t size = 0, resident = 0;
+      if (is >> size >> resident) {
+        return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+      }
+      return 0;
+#endif
+    }
+
+
+    const char* phase_name[RunMetrics::max_phase] = {
+      "growth", "move", "occupancy", "conflicts", "reproduction", "analysis", "observers"
+    };
+
+
+    // label value escaping as required by the exposition format
+    std::string escape(const std::string& str)
+    {
+      std::string esc;
+      for (char c : str) {
+        if (c == '\\' || c == '"') esc.push_back('\\');
+        if (c == '\n') { esc += "\\n"; continue; }
+        esc.push_back(c);
+      }
+      return esc;
+    }
+
+  }
+
+
+  class MetricsObserver : public Observer
+  {
+  public:
+    MetricsObserver(const fs::path& file, float interval, const std::string& run)
+    : Observer(),
+      file_(file),
+      interval_(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<float>(interval))),
+      label_("run=\"" + escape(run) + "\"")
+    {
+    }
+
+    ~MetricsObserver() override
+    {
+      stop();
+    }
+
+    // required observer interface
+    bool notify(void* userdata, long long msg) override
+    {
+      auto sim = reinterpret_cast<const Simulation*>(userdata);
+      using msg_type = Simulation::msg_type;
+
+      switch (msg) {
+        case msg_type::INITIALIZED: {
+          stop();
+          const auto& param = sim->param();
+          total_ = uint64_t(param.Gburnin) * param.T;
+          for (int g = 0; g < param.G; ++g) {
+            total_ += (g > param.Gfix) ? param.Tfix : param.T;
+          }
+          metrics_ = &sim->metrics();
+          finished_ = false;
+          start_ = last_ = RunMetrics::clock::now();
+          last_steps_ = 0;
+          done_ = false;
+          thread_ = std::thread([this]() { run(); });
+          break;
+        }
+        case msg_type::FINISHED:
+          finished_ = true;
+          stop();     // final write
+          break;
+      }
+      return notify_next(userdata, msg);
+    };
+
+  private:
+    void run()
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      for (;;) {
+        cv_.wait_for(lock, interval_, [this]() { return done_; });
+        write();
+        if (done_) return;
+      }
+    }
+
+    void stop()
+    {
+      if (!thread_.joinable()) return;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_ = true;
+      }
+      cv_.notify_one();
+      thread_.join();
+    }
+
+    void write()
+    {
+      const auto& m = *metrics_;
+      const auto now = RunMetrics::clock::now();
+      const double elapsed = std::chrono::duration<double>(now - start_).count();
+      const double dt = std::chrono::duration<double>(now - last_).count();
+      const uint64_t timesteps = m.timesteps.load(std::memory_order_relaxed);
+      const uint64_t steps = m.agent_steps.load(std::memory_order_relaxed);
+      const double rate = (dt > 0.0) ? (steps - last_steps_) / dt : 0.0;
+      const double eta = finished_ ? 0.0 : (timesteps ? (total_ - std::min(total_, timesteps)) * elapsed / timesteps : -1.0);
+      last_ = now;
+      last_steps_ = steps;
+
+      std::ostringstream os;
+      auto metric = [&](const char* name, const char* type, const char* help, auto val) {
+        os << "# HELP kleptomove_" << name << ' ' << help << '\n';
+        os << "# TYPE kleptomove_" << name << ' ' << type << '\n';
+        os << "kleptomove_" << name << '{' << label_ << "} " << val << '\n';
+      };
+      metric("generation", "gauge", "Current generation, -1 during burn-in.", m.generation.load(std::memory_order_relaxed));
+      metric("timestep", "gauge", "Current timestep within the generation.", m.timestep.load(std::memory_order_relaxed));
+      metric("timesteps_total", "counter", "Completed timesteps, burn-in included.", timesteps);
+      metric("timesteps_planned", "gauge", "Timesteps of the whole run, burn-in included.", total_);
+      metric("agent_steps_total", "counter", "Completed agent timesteps.", steps);
+      metric("agent_steps_per_second", "gauge", "Agent timesteps per second since the last update.", rate);
+      os << "# HELP kleptomove_phase_seconds_total Wall time spent per simulation phase.\n";
+      os << "# TYPE kleptomove_phase_seconds_total counter\n";
+      for (int p = 0; p < RunMetrics::max_phase; ++p) {
+        os << "kleptomove_phase_seconds_total{" << label_ << ",phase=\"" << phase_name[p] << "\"} " << 1e-9 * m.phase_ns[p].load(std::memory_order_relaxed) << '\n';
+      }
+      metric("resident_memory_bytes", "gauge", "Resident set size of the process.", resident_memory());
+      metric("archive_bytes_written_total", "counter", "Bytes written into archives.", archive::bytes_written());
+      metric("elapsed_seconds", "gauge", "Wall time since initialization.", elapsed);
+      metric("eta_seconds", "gauge", "Estimated remaining wall time, -1 if unknown.", eta);
+      metric("finished", "gauge", "1 if the simulation has finished.", finished_ ? 1 : 0);
+      metric("last_update_timestamp_seconds", "gauge", "Unix time of this update.",
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+
+      // never throw from here, the next update may succeed
+      std::error_code ec;
+      auto tmp = file_;
+      tmp += ".tmp";
+      {
+        std::ofstream fs(tmp, std::ios::out | std::ios::trunc);
+        if (!(fs << os.str())) return;
+      }
+      fs::rename(tmp, file_, ec);
+    }
+
+    fs::path file_;
+    std::chrono::milliseconds interval_;
+    std::string label_;
+    const RunMetrics* metrics_ = nullptr;
+    uint64_t total_ = 0;
+    uint64_t last_steps_ = 0;
+    RunMetrics::clock::time_point start_, last_;
+    std::atomic<bool> finished_{ false };
+    bool done_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+  };
+
+
+  std::unique_ptr<Observer> CreateMetricsObserver(const std::string& file, float interval, const std::string& run)
+  {
+    fs::path path(file);
+    if (path.has_parent_path()) fs::create_directories(path.parent_path());
+    return std::unique_ptr<Observer>(new MetricsObserver(path, interval, run));
+  }
+
+}
@@ -0,0 +1,58 @@
+#ifndef CINE2_METRICS_H_INCLUDED
+#define CINE2_METRICS_H_INCLUDED
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cine/observer.h>
+
+
+namespace cine2 {
+
+
+  // Progress and throughput counters of a running simulation.
+  // Written by the simulation thread with relaxed atomics, read
+  // concurrently by the metrics exporter. No locks involved.
+  struct RunMetrics
+  {
+    using clock = std::chrono::steady_clock;
+
+    enum Phase : int {
+      growth,           // item growth
+      move,             // agent movement
+      occupancy,        // occupancy updates and landscape records
+      conflicts,        // grazing, attacks and handling
+      reproduction,     // fitness assessment and new generation
+      analysis,         // per-generation analysis and genealogy
+      observers,        // observer chain (output)
+      max_phase
+    };
+
+    std::atomic<int> generation{ -1 };        // -1: burn-in
+    std::atomic<int> timestep{ -1 };
+    std::atomic<uint64_t> timesteps{ 0 };     // completed timesteps, burn-in included
+    std::atomic<uint64_t> agent_steps{ 0 };   // completed agent-timesteps
+    std::atomic<uint64_t> phase_ns[max_phase]{};
+
+    // adds the time since 'start' to phase p, returns now
+    clock::time_point lap(Phase p, clock::time_point start)
+    {
+      const auto now = clock::now();
+      phase_ns[p].fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count()), std::memory_order_relaxed);
+      return now;
+    }
+  };
+
+
+  // Periodically rewrites 'file' in the Prometheus text exposition format
+  // (e.g. for the node_exporter textfile collector). The file is written
+  // from a background thread and replaced atomically (write tmp + rename).
+  // The simulation thread is never blocked, except for the final write
+  // at the end of the run.
+  std::unique_ptr<class Observer> CreateMetricsObserver(const std::string& file, float interval, const std::string& run);
+
+}
+
+
+#endif
@@ -6,6 +6,7 @@
 #include <streambuf>
 #include <filesystem>
 #include "parameter.h"
+#include "archive.hpp"
 
 
 namespace filesystem = std::filesystem;
@@ -34,15 +35,29 @@ namespace cine2 {
     clp_optional_val(outdir, std::string{});
     clp_optional_val(omp_threads, omp_get_max_threads());
     omp_set_num_threads(param.omp_threads);
+    clp_optional_val(genealogy, false);
+    clp_optional_val(owner_computes, false);
+    clp_optional_val(seed, uint64_t(0));
+    clp_optional_val(store, std::string{});
+    if (!param.store.empty() && param.seed == 0) throw cmd::parse_error("store requires a seed");
 
     clp_required(agents.N);
     clp_optional_val(agents.L, 3);
     clp_required(agents.ann);
+    clp_optional_val(agents.ann_store, std::string{});
+    // owner-computes moves the agents in band order, i.e. random access across the mapped files
+    if (param.owner_computes && !param.agents.ann_store.empty()) throw cmd::parse_error("owner_computes can't be combined with agents.ann_store");
 
     clp_optional_val(agents.obligate, false);
     clp_optional_val(agents.forage, false);
     clp_optional_val(agents.sprout_radius, 10000);
     clp_optional_val(agents.flee_radius, 10);
+    clp_optional_val(agents.attack_radius, 0);
+    if (param.agents.attack_radius < 0) throw cmd::parse_error("agents.attack_radius shall be >= 0");
+    clp_optional_val(agents.attack_kernel, std::string("chebyshev"));
+    if (param.agents.attack_kernel != "chebyshev" && param.agents.attack_kernel != "gauss") throw cmd::parse_error("agents.attack_kernel shall be 'chebyshev' or 'gauss'");
+    clp_optional_val(agents.attack_sigma, 1.f);
+    if (param.agents.attack_sigma <= 0.f) throw cmd::parse_error("agents.attack_sigma shall be > 0");
     clp_optional_val(agents.handling_time, 5);
     clp_optional_val(agents.mutation_prob, 0.001f);
     clp_optional_val(agents.mutation_step, 0.001f);
@@ -60,10 +75,60 @@ namespace cine2 {
     clp_optional_val(landscape.max_item_cap, /*1.0f*/10.0f);
 	clp_optional_val(landscape.item_growth,/*0.01f*/0.01f);
 	clp_optional_val(landscape.detection_rate, 0.1f);
+    clp_optional_val(landscape.tile, 0);
+    if (param.landscape.tile != 0 && (param.landscape.tile < 4 || (param.landscape.tile & (param.landscape.tile - 1)) != 0)) {
+      throw cmd::parse_error("landscape.tile shall be 0 or a power of two >= 4");
+    }
 	clp_required(landscape.capacity.image);
     param.landscape.capacity.channel = ImageChannel(clp.required<int>("landscape.capacity.channel"));
     param.landscape.capacity.layer = Landscape::Layers::capacity;
 
+    clp_optional_val(output.mode, std::string("full"));
+    if (param.output.mode != "full" && param.output.mode != "summary") throw cmd::parse_error("output.mode shall be 'full' or 'summary'");
+    clp_optional_val(output.bins, 32);
+    if (param.output.bins < 2) throw cmd::parse_error("output.bins shall be > 1");
+    clp_optional_val(output.codec, std::string("split+zlib:1"));
+    clp_optional_val(output.codec_ann, std::string{});
+    auto check_codec = [](const char* name, const std::string& codec) {
+      try {
+        archive::parse_method(codec);
+      }
+      catch (const std::exception& e) {
+        throw cmd::parse_error(std::string(name) + ": " + e.what());
+      }
+    };
+    check_codec("output.codec", param.output.codec);
+    if (!param.output.codec_ann.empty()) check_codec("output.codec_ann", param.output.codec_ann);
+
+    clp_optional_val(conflicts.log, false);
+    clp_optional_val(conflicts.sample, 1.0f);
+    param.conflicts.roi = { { 0, 0, 0, 0 } };
+    clp_optional_vec(conflicts.roi, param.conflicts.roi);
+
+    clp_optional_val(trajectory.k, 0);
+    clp_optional_val(trajectory.flush, 64);
+    if (param.trajectory.flush < 1) throw cmd::parse_error("trajectory.flush shall be > 0");
+    param.trajectory.roi = { { 0, 0, 0, 0 } };
+    clp_optional_vec(trajectory.roi, param.trajectory.roi);
+
+    clp_optional_val(spatial.rmax, 0);
+    param.spatial.layers = { { Layers::items_rec, Layers::foragers_rec, Layers::klepts_rec } };
+    clp_optional_vec(spatial.layers, param.spatial.layers);
+    for (auto l : param.spatial.layers) {
+      if (l < 0 || l >= Layers::max_layer) throw cmd::parse_error("spatial.layers: invalid layer");
+    }
+
+    clp_optional_val(metrics.file, std::string{});
+    clp_optional_val(metrics.interval, 10.f);
+    if (param.metrics.interval <= 0.f) throw cmd::parse_error("metrics.interval shall be > 0");
+
+    clp_optional_val(strategy.k, 0);
+    clp_optional_val(strategy.batch, 1024);
+    clp_optional_val(strategy.iter, 10);
+
+    clp_optional_val(init_agents_ann, std::string{});
+    clp_optional_val(initG, -1);
+
     clp_optional_val(gui.wait_for_close, true);
     param.gui.selected = { { true, true, true, false } };
     clp_optional_vec(gui.selected, param.gui.selected);
@@ -121,15 +186,23 @@ namespace cine2 {
     stream_str(outdir);
     stream(omp_threads);
     stream(win_rate);
+    stream(genealogy);
+    stream(owner_computes);
+    stream(seed);
+    stream_str(store);
     os << '\n';
 
     stream(agents.N);
     stream(agents.L);
     stream_str(agents.ann);
+    stream_str(agents.ann_store);
     stream(agents.obligate);
     stream(agents.forage);
     stream(agents.sprout_radius);
     stream(agents.flee_radius);
+    stream(agents.attack_radius);
+    stream_str(agents.attack_kernel);
+    stream(agents.attack_sigma);
     stream(agents.handling_time);
     stream(agents.mutation_prob);
     stream(agents.mutation_step);
@@ -145,8 +218,30 @@ namespace cine2 {
     stream(landscape.max_item_cap);
 	stream(landscape.item_growth);
 	stream(landscape.detection_rate); //*&*
+    stream(landscape.tile);
 	stream_str(landscape.capacity.image);
     stream(landscape.capacity.channel);
+    os << '\n';
+
+    stream_str(output.mode);
+    stream(output.bins);
+    stream_str(output.codec);
+    stream_str(output.codec_ann);
+    stream(conflicts.log);
+    stream(conflicts.sample);
+    stream_array(conflicts.roi);
+    stream(trajectory.k);
+    stream(trajectory.flush);
+    stream_array(trajectory.roi);
+    stream(spatial.rmax);
+    stream_array(spatial.layers);
+    stream_str(metrics.file);
+    stream(metrics.interval);
+    stream(strategy.k);
+    stream(strategy.batch);
+    stream(strategy.iter);
+    stream_str(init_agents_ann);
+    stream(initG);
 
     return os;
   }
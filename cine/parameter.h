@@ -63,17 +63,25 @@ namespace cine2 {
     std::string outdir;   // output folder
     int omp_threads;
     float win_rate;
+    bool genealogy;       // record pruned genealogy
+    bool owner_computes;  // threads own row bands of the landscape and their agents
+    uint64_t seed;        // 0: non-deterministic
+    std::string store;    // results store, empty: off
 
     struct ind_param
     {
       int N;
       int L;
       std::string ann;
+      std::string ann_store;    // folder of memory-mapped ANN files, empty: in memory
 
       bool obligate;
       bool forage;
       int sprout_radius;
       int flee_radius;
+      int attack_radius;          // Chebyshev radius of the victim search, 0: same cell
+      std::string attack_kernel;  // victim choice: chebyshev (uniform) | gauss
+      float attack_sigma;         // gauss: standard deviation [cells]
       int handling_time;
       float mutation_prob;
       float mutation_step;
@@ -104,10 +112,52 @@ namespace cine2 {
       float max_item_cap;
 	  float item_growth;
 	  float detection_rate; //*&*
+      int tile;           // block-sparse tile side length, 0: dense
       GaussFilter<3> foragers_kernel;
       GaussFilter<3> klepts_kernel;
     } landscape;
 
+    struct
+    {
+      std::string mode;   // full | summary
+      int bins;           // histogram bins in summary mode
+      std::string codec;      // archive compression: [filter+]codec[:level]
+      std::string codec_ann;  // ann archive compression, empty: codec
+    } output;
+
+    struct
+    {
+      bool log;                   // stream conflict events into conflicts.bin
+      float sample;               // fraction of conflicts logged
+      std::array<int, 4> roi;     // {x0, y0, x1, y1}, empty: whole landscape
+    } conflicts;
+
+    struct
+    {
+      int k;                      // number of tracked agents, 0: off
+      int flush;                  // ring buffer size [timesteps]
+      std::array<int, 4> roi;     // {x0, y0, x1, y1}, empty: whole landscape
+    } trajectory;
+
+    struct
+    {
+      int rmax;                     // max. correlation distance, 0: off
+      std::array<int, 3> layers;    // analysed landscape layers
+    } spatial;
+
+    struct
+    {
+      std::string file;   // Prometheus text file, empty: off
+      float interval;     // update interval [s]
+    } metrics;
+
+    struct
+    {
+      int k;              // number of strategy clusters, 0: off
+      int batch;          // mini-batch size
+      int iter;           // mini-batch iterations per generation
+    } strategy;
+
     struct
     {
       std::deque<std::pair<int,int>> breakpoints{};
@@ -0,0 +1,54 @@
+#include <algorithm>
+#include "partition.h"
+
+
+namespace cine2 {
+
+
+  Partition::Partition(int dim, int bands)
+  : dim_(dim), bands_(std::max(1, std::min(bands, dim)))
+  {
+    band_of_row_.resize(dim_);
+    for (int b = 0; b < bands_; ++b) {
+      for (int y = row_begin(b); y < row_end(b); ++y) band_of_row_[y] = b;
+    }
+    start_.assign(bands_ + 1, 0);
+  }
+
+
+  // Parallel counting sort, every thread bins a contiguous chunk of the population.
+  void Partition::assign(const std::vector<Individual>& pop)
+  {
+    const int N = static_cast<int>(pop.size());
+    idx_.resize(N);
+#   pragma omp parallel
+    {
+      const int nt = omp_get_num_threads();
+      const int t = omp_get_thread_num();
+#     pragma omp single
+      counts_.assign(size_t(nt) * bands_, 0);
+      const int first = static_cast<int>(int64_t(N) * t / nt);
+      const int last = static_cast<int>(int64_t(N) * (t + 1) / nt);
+      int* cnt = counts_.data() + size_t(t) * bands_;
+      for (int i = first; i < last; ++i) ++cnt[band(pop[i].pos.y)];
+#     pragma omp barrier
+#     pragma omp single
+      {
+        // band major, thread minor: indices stay ascending within a band
+        int sum = 0;
+        for (int b = 0; b < bands_; ++b) {
+          start_[b] = sum;
+          for (int s = 0; s < nt; ++s) {
+            int& c = counts_[size_t(s) * bands_ + b];
+            const int n = c;
+            c = sum;
+            sum += n;
+          }
+        }
+        start_[bands_] = sum;
+      }
+      for (int i = first; i < last; ++i) idx_[cnt[band(pop[i].pos.y)]++] = i;
+    }
+  }
+
+}
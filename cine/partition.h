@@ -0,0 +1,75 @@
+#ifndef CINE2_PARTITION_H_INCLUDED
+#define CINE2_PARTITION_H_INCLUDED
+
+#include <omp.h>
+#include <cstdint>
+#include <vector>
+#include "individuals.h"
+
+
+namespace cine2 {
+
+
+  // Owner-computes partition of the landscape.
+  //
+  // The rows are split into bands, band b is owned by OpenMP thread
+  // b % num_threads together with the agents standing in it. Passes that
+  // only touch cells within reach r of an agent run without synchronisation
+  // for agents with interior(pos.y, r); the others go to a serial second
+  // phase. assign() migrates the agents to the owners of their current
+  // rows, call it whenever positions have changed.
+  //
+  // Agents are visited in band order, not in index order. Hence owner-computes
+  // is rejected together with agents.ann_store, which relies on streaming the
+  // mapped ANN files in index order.
+  class Partition
+  {
+  public:
+    Partition() {}
+    Partition(int dim, int bands);
+
+    int bands() const { return bands_; }
+    int row_begin(int band) const { return static_cast<int>(int64_t(band) * dim_ / bands_); }
+    int row_end(int band) const { return row_begin(band + 1); }
+    int band(short y) const { return band_of_row_[y & (dim_ - 1)]; }
+
+    // true if the rows [y - r, y + r] lie within the band of y
+    bool interior(short y, int r) const
+    {
+      const int b = band(y);
+      return (y - r >= row_begin(b)) && (y + r < row_end(b));
+    }
+
+    // sorts the agents into the bands of their positions, ascending index within a band
+    void assign(const std::vector<Individual>& pop);
+
+    // agent indices owned by band
+    const int* begin(int band) const { return idx_.data() + start_[band]; }
+    const int* end(int band) const { return idx_.data() + start_[band + 1]; }
+
+    // calls fun(band) for every band on its owning thread
+    template <typename Fun>
+    void for_each_band(Fun&& fun) const
+    {
+#     pragma omp parallel num_threads(bands_)
+      {
+        const int nt = omp_get_num_threads();
+        for (int b = omp_get_thread_num(); b < bands_; b += nt) {
+          fun(b);
+        }
+      }
+    }
+
+  private:
+    int dim_ = 0;
+    int bands_ = 0;
+    std::vector<int> band_of_row_;
+    std::vector<int> start_;      // bands_ + 1 offsets into idx_
+    std::vector<int> idx_;
+    std::vector<int> counts_;     // scratch: per thread and band
+  };
+
+}
+
+
+#endif
@@ -1,8 +1,18 @@
+#include <omp.h>
 #include "rnd.hpp"
 
 
 namespace rnd {
 
   rndutils::default_engine thread_local reng = rndutils::make_random_engine();
-}
 
+
+  void seed(uint64_t seed)
+  {
+#   pragma omp parallel
+    {
+      const uint64_t x = splitmix64(seed + 0x9e3779b97f4a7c15ull * omp_get_thread_num());
+      reng = rndutils::make_random_engine<rndutils::default_engine>(x);
+    }
+  }
+}
@@ -7,6 +7,19 @@
 namespace rnd {
 
   extern rndutils::default_engine thread_local reng;
+
+  // splitmix64 finalizer: stateless, for per-agent streams
+  inline uint64_t splitmix64(uint64_t x)
+  {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+  }
+
+  // Deterministic seeding: every OpenMP thread gets its own stream derived
+  // from seed and the thread number. Reproducible for a fixed thread count.
+  void seed(uint64_t seed);
 }
 
 #endif
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <numeric>
 #include <filesystem>
 #include "simulation.h"
 #include "game_watches.hpp"
@@ -18,30 +19,40 @@ namespace cine2 {
   {
     using Layers = Landscape::Layers;
 
+    if (param.seed) rnd::seed(param.seed);
+
     agents_.pop = std::vector<Individual>(param.agents.N);
     agents_.tmp_pop = std::vector<Individual>(param.agents.N);
-    agents_.ann = make_any_ann(param.agents.L, param.agents.N, param.agents.ann.c_str());
+    agents_.ann = make_any_ann(param.agents.L, param.agents.N, param.agents.ann.c_str(), param.agents.ann_store);
     agents_.fitness = std::vector<float>(param.agents.N, 0.f);
     agents_.foraged = std::vector<float>(param.agents.N, 0);
     agents_.handled = std::vector<float>(param.agents.N, 0);
     agents_.conflicts = 0;
-    agents_.tmp_ann = make_any_ann(param.agents.L, param.agents.N, param.agents.ann.c_str());
+    agents_.tmp_ann = make_any_ann(param.agents.L, param.agents.N, param.agents.ann.c_str(), param.agents.ann_store);
 
     shuffle_vec.resize(param.agents.N);
     std::iota(shuffle_vec.begin(), shuffle_vec.end(), 0);
 
     agents_.ann->initialize(param.agents);
+    tracks_.reset(param.agents.N, param.trajectory.k, param.trajectory.flush, param.trajectory.roi, param.seed);
 
     // initial landscape layers from image fies
     // CAPACITY NOW REFERS TO REGROWTH RATE
     init_layer(param_.landscape.capacity); //capacity
     if (landscape_.dim() < 32) throw std::runtime_error("Landscape too small");
+    if (2 * param.agents.attack_radius + 1 > landscape_.dim()) throw std::runtime_error("agents.attack_radius exceeds the landscape");
+    landscape_.set_tiles(param.landscape.tile);
+    if (param.owner_computes) {
+      owners_ = Partition(landscape_.dim(), omp_get_max_threads());
+      bands_.resize(owners_.bands());
+    }
 
     // full grass cover
     //for (auto& g : landscape_[Layers::items]) g = param.landscape.max_grass_cover;
     const int DD = landscape_.dim() * landscape_.dim();
     float* __restrict items = landscape_[Layers::items].data();
     float* __restrict capacity = landscape_[Layers::capacity].data();
+#   pragma omp parallel for schedule(static)
     for (int i = 0; i < DD; ++i) {
 
       items[i] = floor(capacity[i] * param.landscape.max_item_cap);
@@ -51,9 +62,16 @@ namespace cine2 {
     //empty grass cover
     //for (auto& g : landscape_[Layers::items]) g = 0.0f;
 
-    // initial positions
-    auto coorDist = std::uniform_int_distribution<short>(0, short(landscape_.dim() - 1));
-    for (auto& p : agents_.pop) { p.pos.x = coorDist(rnd::reng); p.pos.y = coorDist(rnd::reng); }
+    // initial positions from per-agent streams, independent of the number of threads
+    const uint64_t pos_seed = param.seed ? param.seed : static_cast<uint64_t>(rnd::reng());
+    const unsigned mask = static_cast<unsigned>(landscape_.dim() - 1);    // dim is POT
+    const int N = param.agents.N;
+#   pragma omp parallel for schedule(static)
+    for (int i = 0; i < N; ++i) {
+      const uint64_t h = rnd::splitmix64(pos_seed ^ rnd::splitmix64(static_cast<uint64_t>(i)));
+      agents_.pop[i].pos.x = static_cast<short>(h & mask);
+      agents_.pop[i].pos.y = static_cast<short>((h >> 32) & mask);
+    }
 
     // initial occupancies and observable densities
     landscape_.update_occupancy(Layers::foragers_count, Layers::foragers, Layers::klepts_count,
@@ -71,9 +89,13 @@ namespace cine2 {
 
   void Simulation::init_anns_from_archive(Population& Pop, archive::iarch& ia)
   {
-    auto cm = ia.extract(param_.initG >= 0 ? std::min(param_.initG, param_.G - 1) : param_.G - 1);
-    if (cm.un != Pop.ann->N()) throw cmd::parse_error("Number of ANNs doesn't match");
-    if (cm.usize != Pop.ann->type_size()) throw cmd::parse_error("ANN state size doesn't match");
+    const int G = static_cast<int>(ia.size());
+    if (G == 0) throw cmd::parse_error("init_agents_ann holds no generation");
+    const int g = (param_.initG >= 0) ? param_.initG : G - 1;
+    if (g >= G) throw cmd::parse_error("initG exceeds the generations in init_agents_ann");
+    auto cm = ia.extract(g);
+    if (cm.un != static_cast<uint32_t>(Pop.ann->N())) throw cmd::parse_error("Number of ANNs doesn't match");
+    if (cm.usize != Pop.ann->state_size() * sizeof(float)) throw cmd::parse_error("ANN state size doesn't match");
     auto dst = Pop.ann->data();
     uncompress(dst, cm, Pop.ann->stride() * sizeof(float));
   }
@@ -100,7 +122,7 @@ namespace cine2 {
     }
 
 
-    void create_new_generation(const Landscape& landscape,
+    void create_new_generation(Landscape& landscape,
       Population& population,
       const Param::ind_param& iparam,
       bool fixed)
@@ -119,7 +141,25 @@ namespace cine2 {
           const int ancestor = rdist(rnd::reng);
           auto newPos = pop[ancestor].pos + Coordinate{ coorDist(rnd::reng), coorDist(rnd::reng) };
           tmp_pop[i].sprout(landscape.wrap(newPos), ancestor);
-          tmp_ann.assign(ann, ancestor, i);   // copy ann
+          if (!ann.mapped()) tmp_ann.assign(ann, ancestor, i);   // copy ann
+        }
+      }
+      if (ann.mapped()) {
+        // Offspring order is arbitrary: sort the offspring by ancestor
+        // (counting sort) to stream through both ANN files in order.
+        auto& tmp_pop = population.tmp_pop;
+        std::vector<int> first(N + 1, 0);
+        for (const auto& ind : tmp_pop) ++first[ind.ancestor + 1];
+        std::partial_sum(first.begin(), first.end(), first.begin());
+        std::vector<Individual> sorted(N);
+        for (const auto& ind : tmp_pop) sorted[first[ind.ancestor]++] = ind;
+        tmp_pop.swap(sorted);
+        auto& tmp_ann = *population.tmp_ann;
+        ann.prefetch(0, std::min(N, any_ann::prefetch_window));
+        tmp_ann.prefetch(0, std::min(N, any_ann::prefetch_window));
+#       pragma omp parallel for schedule(static)
+        for (int i = 0; i < N; ++i) {
+          tmp_ann.assign(ann, tmp_pop[i].ancestor, i);
         }
       }
       population.tmp_ann->mutate(iparam, fixed);
@@ -130,16 +170,12 @@ namespace cine2 {
       swap(population.pop, population.tmp_pop);
       swap(population.ann, population.tmp_ann);
 
-      LayerView items_rec = landscape[Landscape::Layers::items_rec];
-      LayerView foragers_rec = landscape[Landscape::Layers::foragers_rec];
-      LayerView klepts_rec = landscape[Landscape::Layers::klepts_rec];
-      LayerView foragers_intake = landscape[Landscape::Layers::foragers_intake];
-      LayerView klepts_intake = landscape[Landscape::Layers::klepts_intake];
-      items_rec.clear();
-      foragers_rec.clear();
-      klepts_rec.clear();
-      foragers_intake.clear();
-      klepts_intake.clear();
+      landscape.clear(Landscape::Layers::items_rec);
+      landscape.clear(Landscape::Layers::foragers_rec);
+      landscape.clear(Landscape::Layers::klepts_rec);
+      landscape.clear(Landscape::Layers::foragers_intake);
+      landscape.clear(Landscape::Layers::klepts_intake);
+      landscape.restart_records();
     }
 
 
@@ -157,6 +193,22 @@ namespace cine2 {
       }
     }
 
+
+    // calls fun(i) for every cell of the listed tiles, band-wise on the
+    // owning threads if owner-computes is on
+    template <typename Fun>
+    void for_each_cell(const Landscape& landscape, const Partition& owners, const std::vector<int>& tiles, Fun&& fun)
+    {
+      if (owners.bands()) {
+        owners.for_each_band([&](int b) {
+          landscape.for_each_cell(tiles, owners.row_begin(b), owners.row_end(b), fun);
+        });
+      }
+      else {
+        landscape.for_each_cell(tiles, fun);
+      }
+    }
+
   }
 
 
@@ -181,19 +233,25 @@ namespace cine2 {
       // clear fitness
       agents_.fitness.assign(agents_.fitness.size(), 0.f);
 
+      const auto t0 = RunMetrics::clock::now();
       assess_fitness(); //CN: fix?
       create_new_generations();
+      metrics_.lap(RunMetrics::reproduction, t0);
     }
     const int G = param_.G;
 
 
 
     for (g_ = 0; g_ < G; ++g_) {
+      metrics_.generation.store(g_, std::memory_order_relaxed);
+      tracks_.select(g_, agents_.pop);
       simulation_observer_notify(NEW_GENERATION);
       const int T = fixed() ? param_.Tfix : param_.T;
       for (t_ = 0; t_ < T; ++t_) {
         simulate_timestep(t_);
+        const auto t0 = RunMetrics::clock::now();
         simulation_observer_notify(POST_TIMESTEP);
+        metrics_.lap(RunMetrics::observers, t0);
         
         
         
@@ -248,11 +306,17 @@ namespace cine2 {
         //writeoutcapacity.close();
       }
 
+      auto t0 = RunMetrics::clock::now();
       assess_fitness();
       assess_inds();
+      t0 = metrics_.lap(RunMetrics::reproduction, t0);
       analysis_.generation(this);
+      if (param_.genealogy) genealogy_.add_generation(g_, agents_.pop);
+      t0 = metrics_.lap(RunMetrics::analysis, t0);
       simulation_observer_notify(GENERATION);
+      t0 = metrics_.lap(RunMetrics::observers, t0);
       create_new_generations();
+      metrics_.lap(RunMetrics::reproduction, t0);
     }
 
 
@@ -267,9 +331,9 @@ namespace cine2 {
   void Simulation::simulate_timestep(const int t)
   {
     using Layers = Landscape::Layers;
+    auto t0 = RunMetrics::clock::now();
 
-    // grass growth
-    const int DD = landscape_.dim() * landscape_.dim();
+    // grass growth, habitat tiles only
     float* __restrict items = landscape_[Layers::items].data();					//items now refers to the layer of food items (in landscape)
     float* __restrict capacity = landscape_[Layers::capacity].data();			//capacity refers to the maximum capacity layer (in landscape)
     ann_assume_aligned(items, 32);
@@ -277,27 +341,31 @@ namespace cine2 {
     const float item_growth = param_.landscape.item_growth;
     //#   pragma omp parallel for schedule(static)
 
-    for (int i = 0; i < DD; ++i) {
+    detail::for_each_cell(landscape_, owners_, landscape_.live_tiles(Layers::items), [&](int i) {
       if (std::bernoulli_distribution(item_growth * capacity[i])(rnd::reng) ) {  // altered: probability that items drop, && capacity[i] > 0.2
         items[i] = std::min(floor(max_item_cap), floor(items[i] + 1.0f));
       }
-    }
+    });
 
 
 
     //landscape_.update_occupancy(Layers::foragers_count, Layers::foragers, Layers::klepts_count, Layers::klepts, Layers::handlers_count, Layers::handlers, Layers::nonhandlers, agents_.pop.cbegin(), agents_.pop.cend(), param_.landscape.foragers_kernel);
 
+    t0 = metrics_.lap(RunMetrics::growth, t0);
+
     // move
-    agents_.ann->move(landscape_, agents_.pop, param_.agents);
+    const Partition* owners = owners_.bands() ? &owners_ : nullptr;
+    if (owners) owners_.assign(agents_.pop);
+    agents_.ann->move(landscape_, agents_.pop, param_.agents, tracks_.active() ? &tracks_ : nullptr, owners);
+    if (owners) owners_.assign(agents_.pop);    // migrate to the owners of the new cells
+    t0 = metrics_.lap(RunMetrics::move, t0);
 
     // update occupancies and observable densities
-    landscape_.update_occupancy(Layers::foragers_count, Layers::foragers, Layers::klepts_count, Layers::klepts, Layers::handlers_count, Layers::handlers, Layers::nonhandlers, agents_.pop.cbegin(), agents_.pop.cend(), param_.landscape.foragers_kernel);
+    update_occupancy();
 
     if (t == param_.T / 2) {
-      LayerView foragers_intake = landscape_[Landscape::Layers::foragers_intake];
-      LayerView klepts_intake = landscape_[Landscape::Layers::klepts_intake];
-      foragers_intake.clear();
-      klepts_intake.clear();
+      landscape_.clear(Layers::foragers_intake);
+      landscape_.clear(Layers::klepts_intake);
     }
 
     if ( t >= param_.T / 2) {
@@ -306,20 +374,38 @@ namespace cine2 {
     }
 
 
+    t0 = metrics_.lap(RunMetrics::occupancy, t0);
+
     //RESOLVE GRAZING AND ATTACK function!
     resolve_grazing_and_attacks();
+    t0 = metrics_.lap(RunMetrics::conflicts, t0);
+
+
+    update_occupancy();
 
+    if (tracks_.active()) tracks_.record(agents_.pop);
+    metrics_.lap(RunMetrics::occupancy, t0);
+    metrics_.timestep.store(t, std::memory_order_relaxed);
+    metrics_.timesteps.fetch_add(1, std::memory_order_relaxed);
+    metrics_.agent_steps.fetch_add(agents_.pop.size(), std::memory_order_relaxed);
 
-    landscape_.update_occupancy(Layers::foragers_count, Layers::foragers, Layers::klepts_count, Layers::klepts, Layers::handlers_count, Layers::handlers, Layers::nonhandlers, agents_.pop.cbegin(), agents_.pop.cend(), param_.landscape.foragers_kernel);
+  }
 
+  void Simulation::update_occupancy()
+  {
+    using Layers = Landscape::Layers;
+    if (owners_.bands()) {
+      landscape_.update_occupancy_owned(Layers::foragers_count, Layers::foragers, Layers::klepts_count, Layers::klepts, Layers::handlers_count, Layers::handlers, Layers::nonhandlers, agents_.pop, owners_, param_.landscape.foragers_kernel);
+    }
+    else {
+      landscape_.update_occupancy(Layers::foragers_count, Layers::foragers, Layers::klepts_count, Layers::klepts, Layers::handlers_count, Layers::handlers, Layers::nonhandlers, agents_.pop.cbegin(), agents_.pop.cend(), param_.landscape.foragers_kernel);
+    }
   }
 
   void Simulation::update_landscaperecord()
   {
     using Layers = Landscape::Layers;
 
-    // grass growth
-    const int DD = landscape_.dim() * landscape_.dim();
     float* __restrict items = landscape_[Layers::items].data();					//items now refers to the layer of food items (in landscape)
     float* __restrict foragers_count = landscape_[Layers::foragers_count].data();			//capacity refers to the maximum capacity layer (in landscape)
     float* __restrict klepts_count = landscape_[Layers::klepts_count].data();			//capacity refers to the maximum capacity layer (in landscape)
@@ -328,12 +414,13 @@ namespace cine2 {
     float* __restrict klepts_rec = landscape_[Layers::klepts_rec].data();			//capacity refers to the maximum capacity layer (in landscape)
     //#   pragma omp parallel for schedule(static)
 
-    for (int i = 0; i < DD; ++i) {
+    detail::for_each_cell(landscape_, owners_, landscape_.live_tiles(Layers::items), [&](int i) {
       items_rec[i] += items[i];
+    });
+    detail::for_each_cell(landscape_, owners_, landscape_.live_tiles(Layers::foragers_count), [&](int i) {
       foragers_rec[i] += foragers_count[i];
       klepts_rec[i] += klepts_count[i];
-
-    }
+    });
   }
 
   void Simulation::assess_fitness()
@@ -356,57 +443,45 @@ namespace cine2 {
   void Simulation::resolve_grazing_and_attacks()
   {
     using Layers = Landscape::Layers;
-    const float detection_rate = param_.landscape.detection_rate;
-    const float win_rate = param_.win_rate;
     //LayerView foragers_count = landscape_[Layers::foragers_count];
     //LayerView klepts_count = landscape_[Layers::klepts_count];
     //LayerView capacity = landscape_[Layers::capacity];
-    LayerView items = landscape_[Layers::items];
-    LayerView foragers_intake = landscape_[Layers::foragers_intake];
-    LayerView klepts_intake = landscape_[Layers::klepts_intake];
     LayerView handlers = landscape_[Layers::handlers_count];
-    LayerView old_grass = landscape_[Layers::temp];
-    old_grass.copy(handlers);
 
 
     attacking_inds_.clear();
     attacked_potentially_.clear();
     attacked_inds.clear();
+    conflict_events_.clear();
 
-    auto last_agents = agents_.pop.data() + agents_.pop.size();
-
-
+    const int attack_radius = param_.agents.attack_radius;
+    const float attack_sigma = (param_.agents.attack_kernel == "gauss") ? param_.agents.attack_sigma : 0.f;
+    if (owners_.bands()) {
+      resolve_grazing_and_attacks_owned(attack_radius, attack_sigma);
+      return;
+    }
     for (int i = 0; i < agents_.pop.size(); ++i) {
       if (!agents_.pop[i].handling && !agents_.pop[i].foraging) {
 
         const Coordinate pos = agents_.pop[i].pos;
-        if (handlers(pos) >= 1.0f) {
+        if (attack_radius > 0 || handlers(pos) >= 1.0f) {
           attacking_inds_.push_back(i);
 
         }
       }
     }
 
+    index_handlers();
+    size_t attackers = 0;
     for (auto i : attacking_inds_) {						//cycle through the agents in that same vector
 
-      for (auto attacked_pot = agents_.pop.data(); attacked_pot != last_agents; ++attacked_pot) {
-        const Coordinate pos = attacked_pot->pos;
-        if (agents_.pop[i].pos == pos && &agents_.pop[i] != attacked_pot) {  // self excluded
-          if (attacked_pot->handling) {
-            attacked_potentially_.push_back(attacked_pot);
-
-          }
-        }
-      }
-      if (!attacked_potentially_.empty()) {								//if then that vector is NOT empty
-        std::uniform_int_distribution<int> rind(0, static_cast<int>(attacked_potentially_.size() - 1));		//sample one (random)
-        int focal_ind = rind(rnd::reng);																	//now called "focal_ind"
-        attacked_inds.push_back(attacked_potentially_[focal_ind]);			//added to the vector of ACTUALLY ATTACKED.
-
-        attacked_potentially_.clear();										//clearing the POTENTIALLY ATTACKED vector
+      if (Individual* victim = pick_victim(i, attack_radius, attack_sigma, attacked_potentially_, victim_weights_)) {
+        attacked_inds.push_back(victim);			//added to the vector of ACTUALLY ATTACKED.
+        attacking_inds_[attackers++] = i;   // attackers without victim in range drop out (attack_radius > 0 only)
       }
 
     }
+    attacking_inds_.resize(attackers);
 
 
     assert(attacked_inds.size() == attacking_inds_.size() && "vector lengths uneven");
@@ -420,84 +495,245 @@ namespace cine2 {
 
 
     for (int i = 0; i < conflicts_v.size(); i++) {				//cycle through the agents who attack
-      float prob_to_fight = 1.0f;									//they always fight
+      fight(conflicts_v[i].first, conflicts_v[i].second, conflict_events_);
+    }
 
-      //if (attacked_inds[i]->handle())
-      //  prob_to_fight = 0.5f;
-      //else
-      //  prob_to_fight = 0.2f;
+    agents_.conflicts += static_cast<int>(conflicts_v.size());
 
+    conflicts_v.clear();
 
-      std::bernoulli_distribution fight(prob_to_fight);								//sampling whether fight occurs
-      std::bernoulli_distribution initiator_wins(win_rate)/*initiator always wins*/;		//sampling whether the initiator wins or not
-      if (conflicts_v[i].second->handling) {			///isn't this always true?
-        if (fight(rnd::reng)) {
-          if (initiator_wins(rnd::reng)) {
+    std::shuffle(shuffle_vec.begin(), shuffle_vec.end(), rnd::reng);
 
-            agents_.pop[conflicts_v[i].first].handling = conflicts_v[i].second->handling;
-            agents_.pop[conflicts_v[i].first].handle_time = conflicts_v[i].second->handle_time;
-            //attacking_inds_[i]->food += 1.0f;
-            conflicts_v[i].second->flee(landscape_, param_.agents.flee_radius);
 
-          }
-          else
-            agents_.pop[conflicts_v[i].first].attacker_flee(landscape_, param_.agents.flee_radius);
-          //Energetic costs
 
-          //attacking_inds_[i]->food -= 0.0f;
-          //attacked_inds[i]->food -= 0.0f;
+    for (int i : shuffle_vec) {
+      forage(agents_.pop[i]);
+    }
 
-        }
 
+
+  }
+
+
+  // Owner-computes variant. Attackers whose attack window stays inside their
+  // band pick victims and fight on the owning thread, the others in a serial
+  // second phase. Foraging is cell-local, it runs band-wise after the agents
+  // that fled have migrated to their new owners.
+  void Simulation::resolve_grazing_and_attacks_owned(int attack_radius, float attack_sigma)
+  {
+    const LayerView handlers = landscape_[Landscape::Layers::handlers_count];
+
+    index_handlers();
+    owners_.for_each_band([&](int b) {
+      auto& band = bands_[b];
+      band.conflicts.clear();
+      band.events.clear();
+      band.boundary.clear();
+      for (auto it = owners_.begin(b); it != owners_.end(b); ++it) {
+        const Individual& ind = agents_.pop[*it];
+        if (!ind.handling && !ind.foraging && (attack_radius > 0 || handlers(ind.pos) >= 1.0f)) {
+          if (!owners_.interior(ind.pos.y, attack_radius)) {
+            band.boundary.push_back(*it);
+          }
+          else if (Individual* victim = pick_victim(*it, attack_radius, attack_sigma, band.victims, band.weights)) {
+            band.conflicts.push_back({ *it, victim });
+          }
+        }
+      }
+      std::shuffle(band.conflicts.begin(), band.conflicts.end(), rnd::reng);
+      for (const auto& c : band.conflicts) fight(c.first, c.second, band.events);
+    });
+
+    // second phase: attacks across band boundaries
+    std::vector<std::pair<int, Individual*>> conflicts_v;
+    int conflicts = 0;
+    for (const auto& band : bands_) {
+      for (int i : band.boundary) {
+        if (Individual* victim = pick_victim(i, attack_radius, attack_sigma, attacked_potentially_, victim_weights_)) {
+          conflicts_v.push_back({ i, victim });
+        }
       }
+      conflicts += static_cast<int>(band.conflicts.size());
+      conflict_events_.insert(conflict_events_.end(), band.events.cbegin(), band.events.cend());
     }
+    std::shuffle(conflicts_v.begin(), conflicts_v.end(), rnd::reng);
+    for (const auto& c : conflicts_v) fight(c.first, c.second, conflict_events_);
+    agents_.conflicts += conflicts + static_cast<int>(conflicts_v.size());
+
+    owners_.assign(agents_.pop);
+    owners_.for_each_band([&](int b) {
+      auto& order = bands_[b].order;
+      order.assign(owners_.begin(b), owners_.end(b));
+      std::shuffle(order.begin(), order.end(), rnd::reng);
+      for (int i : order) forage(agents_.pop[i]);
+    });
+  }
 
-    agents_.conflicts += static_cast<int>(conflicts_v.size());
 
-    conflicts_v.clear();
+  // Picks a random victim among the handling agents in range of the attacker,
+  // nullptr if there is none. victims, weights: scratch.
+  Individual* Simulation::pick_victim(int attacker, int radius, float sigma, std::vector<Individual*>& victims, std::vector<float>& weights)
+  {
+    gather_victims(attacker, radius, sigma, victims, weights);
+    if (victims.empty()) return nullptr;
+    int focal_ind;
+    if (radius == 0 || sigma == 0.f) {
+      std::uniform_int_distribution<int> rind(0, static_cast<int>(victims.size() - 1));		//sample one (random)
+      focal_ind = rind(rnd::reng);																	//now called "focal_ind"
+    }
+    else {
+      const float u = std::uniform_real_distribution<float>(0.f, weights.back())(rnd::reng);
+      focal_ind = static_cast<int>(std::upper_bound(weights.cbegin(), weights.cend(), u) - weights.cbegin());
+      focal_ind = std::min(focal_ind, static_cast<int>(victims.size() - 1));
+    }
+    Individual* victim = victims[focal_ind];
+    victims.clear();										//clearing the POTENTIALLY ATTACKED vector
+    return victim;
+  }
 
-    std::shuffle(shuffle_vec.begin(), shuffle_vec.end(), rnd::reng);
 
+  void Simulation::fight(int attacker, Individual* victim, std::vector<ConflictEvent>& events)
+  {
+    float prob_to_fight = 1.0f;									//they always fight
 
+    //if (attacked_inds[i]->handle())
+    //  prob_to_fight = 0.5f;
+    //else
+    //  prob_to_fight = 0.2f;
+
+
+    std::bernoulli_distribution fight(prob_to_fight);								//sampling whether fight occurs
+    std::bernoulli_distribution initiator_wins(param_.win_rate)/*initiator always wins*/;		//sampling whether the initiator wins or not
+    if (victim->handling) {			///isn't this always true?
+      if (fight(rnd::reng)) {
+        const bool won = initiator_wins(rnd::reng);
+        if (param_.conflicts.log) {
+          record_conflict(agents_.pop[attacker].pos, attacker, static_cast<int>(victim - agents_.pop.data()), won, events);
+        }
+        if (won) {
+
+          agents_.pop[attacker].handling = victim->handling;
+          agents_.pop[attacker].handle_time = victim->handle_time;
+          //attacking_inds_[i]->food += 1.0f;
+          victim->flee(landscape_, param_.agents.flee_radius);
 
-    for (int i : shuffle_vec) {
-      auto& agent = agents_.pop[i];
-      //for (auto agents = agents_.pop.data(); agents != last_agents; ++agents) {
-      if (agent.handle() == false) {
-        const Coordinate pos = agent.pos;
-
-        if (agent.foraging && !agent.just_lost) {
-          if (items(pos) >= 1.0f) {
-            if (std::bernoulli_distribution(1.0 - pow((1.0f - detection_rate), items(pos)))(rnd::reng)) { // Ind searching for items
-              agent.pick_item(param_.agents.handling_time);
-              items(pos) -= 1.0f;
-            }
-          }
         }
+        else
+          agents_.pop[attacker].attacker_flee(landscape_, param_.agents.flee_radius);
+        //Energetic costs
+
+        //attacking_inds_[i]->food -= 0.0f;
+        //attacked_inds[i]->food -= 0.0f;
+
       }
 
+    }
+  }
 
 
-      else {
-        if (agent.do_handle()) {
-          if (agent.foraging) {
-            foragers_intake(agent.pos) += 1.0f;
+  void Simulation::forage(Individual& agent)
+  {
+    using Layers = Landscape::Layers;
+    const float detection_rate = param_.landscape.detection_rate;
+    LayerView items = landscape_[Layers::items];
+    LayerView foragers_intake = landscape_[Layers::foragers_intake];
+    LayerView klepts_intake = landscape_[Layers::klepts_intake];
 
-          }
-          else {
-            klepts_intake(agent.pos) += 1.0f;
+    if (agent.handle() == false) {
+      const Coordinate pos = agent.pos;
+
+      if (agent.foraging && !agent.just_lost) {
+        if (items(pos) >= 1.0f) {
+          if (std::bernoulli_distribution(1.0 - pow((1.0f - detection_rate), items(pos)))(rnd::reng)) { // Ind searching for items
+            agent.pick_item(param_.agents.handling_time);
+            items(pos) -= 1.0f;
           }
         }
+      }
+    }
+
+
+
+    else {
+      if (agent.do_handle()) {
+        if (agent.foraging) {
+          foragers_intake(agent.pos) += 1.0f;
 
+        }
+        else {
+          klepts_intake(agent.pos) += 1.0f;
+        }
       }
 
-      if (agent.just_lost) {
-        agent.just_lost = false;
+    }
+
+    if (agent.just_lost) {
+      agent.just_lost = false;
+    }
+  }
+
+
+  // Grid-bucket index of the handling agents, rebuilt every timestep
+  // by counting sort over the cells. Stable: ascending agent index within
+  // a cell, the order of the former linear scan.
+  void Simulation::index_handlers()
+  {
+    const int dim = landscape_.dim();
+    const int N = static_cast<int>(agents_.pop.size());
+    handler_start_.assign(static_cast<size_t>(dim) * dim + 2, 0);
+    int handling = 0;
+    for (const auto& ind : agents_.pop) {
+      if (ind.handling) {
+        ++handler_start_[dim * ind.pos.y + ind.pos.x + 2];
+        ++handling;
+      }
+    }
+    std::partial_sum(handler_start_.begin(), handler_start_.end(), handler_start_.begin());
+    handler_idx_.resize(handling);
+    for (int i = 0; i < N; ++i) {
+      const auto& ind = agents_.pop[i];
+      if (ind.handling) {
+        handler_idx_[handler_start_[dim * ind.pos.y + ind.pos.x + 1]++] = i;
       }
     }
+    // handler_start_[cell + 1] is now the end of cell, handler_start_[cell] its start
+  }
+
 
+  // Collects the handling agents within Chebyshev distance 'radius' of the attacker
+  // into victims. sigma > 0: cumulative Gaussian weights into weights.
+  void Simulation::gather_victims(int attacker, int radius, float sigma, std::vector<Individual*>& victims, std::vector<float>& weights)
+  {
+    const Coordinate pos = agents_.pop[attacker].pos;
+    const int dim = landscape_.dim();
+    const float c = (sigma > 0.f) ? -0.5f / (sigma * sigma) : 0.f;
+    float cum = 0.f;
+    weights.clear();
+    for (int dy = -radius; dy <= radius; ++dy) {
+      for (int dx = -radius; dx <= radius; ++dx) {
+        const Coordinate cell = landscape_.wrap(pos + Coordinate{ short(dx), short(dy) });
+        const int ci = dim * cell.y + cell.x;
+        const float w = std::exp(c * float(dx * dx + dy * dy));
+        for (int k = handler_start_[ci]; k < handler_start_[ci + 1]; ++k) {
+          const int j = handler_idx_[k];
+          if (j != attacker) {    // self excluded
+            victims.push_back(&agents_.pop[j]);
+            if (sigma > 0.f) weights.push_back(cum += w);
+          }
+        }
+      }
+    }
+  }
 
 
+  void Simulation::record_conflict(Coordinate pos, int attacker, int victim, bool won, std::vector<ConflictEvent>& events)
+  {
+    const auto& roi = param_.conflicts.roi;
+    if (roi[2] > roi[0] && roi[3] > roi[1]) {
+      if (pos.x < roi[0] || pos.x >= roi[2] || pos.y < roi[1] || pos.y >= roi[3]) return;
+    }
+    if (!conflict_log::sampled(param_.conflicts.sample, g_, t_, attacker)) return;
+    events.push_back({ pos.y * landscape_.dim() + pos.x, attacker, victim, won ? 1 : 0 });
   }
 
 
@@ -10,6 +10,11 @@
 #include "any_ann.hpp"
 #include "analysis.h"
 #include "archive.hpp"
+#include "genealogy.h"
+#include "conflict_log.h"
+#include "trajectory.h"
+#include "metrics.h"
+#include "partition.h"
 
 
 namespace cine2 {
@@ -51,6 +56,10 @@ namespace cine2 {
     const Landscape& landscape() const { return landscape_; }
     const Param& param() const { return param_; }
     const Analysis& analysis() const { return analysis_; }
+    const Genealogy& genealogy() const { return genealogy_; }
+    const std::vector<ConflictEvent>& conflict_events() const { return conflict_events_; }   // last timestep
+    const Trajectories& trajectories() const { return tracks_; }
+    const RunMetrics& metrics() const { return metrics_; }
 
     int generation() const { return g_; }   // current generation
     int timestep() const { return t_; }     // current timestep
@@ -62,11 +71,19 @@ namespace cine2 {
 
   private:
     void simulate_timestep(int t);
+    void update_occupancy();
     void update_landscaperecord();
     void assess_fitness();
     void assess_inds();
     void create_new_generations();
     void resolve_grazing_and_attacks();
+    void resolve_grazing_and_attacks_owned(int attack_radius, float attack_sigma);
+    void index_handlers();
+    void gather_victims(int attacker, int radius, float sigma, std::vector<Individual*>& victims, std::vector<float>& weights);
+    Individual* pick_victim(int attacker, int radius, float sigma, std::vector<Individual*>& victims, std::vector<float>& weights);
+    void fight(int attacker, Individual* victim, std::vector<ConflictEvent>& events);
+    void forage(Individual& agent);
+    void record_conflict(Coordinate pos, int attacker, int victim, bool won, std::vector<ConflictEvent>& events);
     void init_layer(image_layer imla);
     void init_anns_from_archive(Population& Pop, archive::iarch& ia);
 
@@ -77,9 +94,29 @@ namespace cine2 {
     std::vector<int> attacking_inds_;
     std::vector<Individual*> attacked_potentially_;
     std::vector<Individual*> attacked_inds;
+    std::vector<float> victim_weights_;   // cumulative, gauss kernel only
+    std::vector<int> handler_start_;      // grid-bucket index: cell -> [start[cell], start[cell + 1])
+    std::vector<int> handler_idx_;        // handling agents, by cell, ascending index within cell
     std::vector<int> shuffle_vec;
+    std::vector<ConflictEvent> conflict_events_;
+
+    // owner-computes scratch, one per band
+    struct Band
+    {
+      std::vector<Individual*> victims;
+      std::vector<float> weights;
+      std::vector<std::pair<int, Individual*>> conflicts;
+      std::vector<ConflictEvent> events;
+      std::vector<int> boundary;    // attackers reaching into other bands
+      std::vector<int> order;       // foraging order
+    };
+    Partition owners_;              // bands() == 0: owner-computes off
+    std::vector<Band> bands_;
+    Trajectories tracks_;
     Landscape landscape_;
     Analysis analysis_;
+    Genealogy genealogy_;
+    RunMetrics metrics_;
   };
 
 
@@ -0,0 +1,219 @@
+#include <omp.h>
+#include <cmath>
+#include <filesystem>
+#include "simulation.h"
+#include "spatial.h"
+#include "archive.hpp"
+
+
+namespace fs = std::filesystem;
+
+
+namespace cine2 {
+
+
+  Fft2d::Fft2d(int dim)
+  : dim_(dim)
+  {
+    if (dim < 2 || (dim & (dim - 1))) throw std::runtime_error("Fft2d: dim shall be a power of two");
+    int bits = 0;
+    while ((1 << bits) < dim) ++bits;
+    rev_.resize(dim);
+    for (int i = 0; i < dim; ++i) {
+      int r = 0;
+      for (int b = 0; b < bits; ++b) r |= ((i >> b) & 1) << (bits - 1 - b);
+      rev_[i] = r;
+    }
+    const double pi = std::acos(-1.0);
+    twiddle_.resize(dim / 2);
+    for (int k = 0; k < dim / 2; ++k) {
+      twiddle_[k] = std::polar(1.0, -2.0 * pi * k / dim);
+    }
+  }
+
+
+  void Fft2d::fft1d(complex_t* x, bool inverse) const
+  {
+    for (int i = 0; i < dim_; ++i) {
+      if (i < rev_[i]) std::swap(x[i], x[rev_[i]]);
+    }
+    for (int len = 2; len <= dim_; len <<= 1) {
+      const int half = len >> 1;
+      const int step = dim_ / len;
+      for (int i = 0; i < dim_; i += len) {
+        for (int j = 0; j < half; ++j) {
+          const complex_t w = inverse ? std::conj(twiddle_[j * step]) : twiddle_[j * step];
+          const complex_t u = x[i + j];
+          const complex_t v = x[i + j + half] * w;
+          x[i + j] = u + v;
+          x[i + j + half] = u - v;
+        }
+      }
+    }
+  }
+
+
+  void Fft2d::transform(complex_t* data, bool inverse) const
+  {
+    const int dim = dim_;
+#   pragma omp parallel
+    {
+#     pragma omp for schedule(static)
+      for (int y = 0; y < dim; ++y) {
+        fft1d(data + static_cast<size_t>(y) * dim, inverse);
+      }
+      std::vector<complex_t> col(dim);
+#     pragma omp for schedule(static)
+      for (int x = 0; x < dim; ++x) {
+        for (int y = 0; y < dim; ++y) col[y] = data[static_cast<size_t>(y) * dim + x];
+        fft1d(col.data(), inverse);
+        for (int y = 0; y < dim; ++y) data[static_cast<size_t>(y) * dim + x] = col[y];
+      }
+    }
+  }
+
+
+  class SpatialObserver : public Observer
+  {
+  public:
+    explicit SpatialObserver(const fs::path& path)
+    : Observer(),
+      folder(path)
+    {
+    }
+
+    ~SpatialObserver() override
+    {
+    }
+
+    // required observer interface
+    bool notify(void* userdata, long long msg) override
+    {
+      auto sim = reinterpret_cast<const Simulation*>(userdata);
+      using msg_type = Simulation::msg_type;
+
+      switch (msg) {
+        case msg_type::INITIALIZED:
+          setup(sim->landscape().dim(), sim->param().spatial.rmax);
+          oa_agents_spa_.open(folder / "agents_spa.arc", "spatial");
+          method_ = archive::parse_method(sim->param().output.codec);
+          break;
+        case msg_type::GENERATION:
+          analyse(sim->landscape(), sim->param().spatial.layers);
+          oa_agents_spa_.insert(archive::compress(records_.data(), rows_, R_ * sizeof(float), 0, method_));
+          break;
+        case msg_type::FINISHED:
+          oa_agents_spa_.close();
+          break;
+      }
+      return notify_next(userdata, msg);
+    };
+
+  private:
+    void setup(int dim, int rmax)
+    {
+      fft_.reset(new Fft2d(dim));
+      rmax_ = std::min(rmax, dim / 2);
+      const size_t DD = static_cast<size_t>(dim) * dim;
+      rbin_.resize(DD);
+      rcount_.assign(rmax_ + 1, 0);
+      for (int y = 0; y < dim; ++y) {
+        const int dy = (y < dim / 2) ? y : y - dim;
+        for (int x = 0; x < dim; ++x) {
+          const int dx = (x < dim / 2) ? x : x - dim;
+          const int r = static_cast<int>(std::lround(std::sqrt(double(dx * dx + dy * dy))));
+          rbin_[static_cast<size_t>(y) * dim + x] = (r <= rmax_) ? r : -1;
+          if (r <= rmax_) ++rcount_[r];
+        }
+      }
+      R_ = 6 + rmax_ + 1;
+    }
+
+
+    void analyse(const Landscape& landscape, const std::array<int, 3>& layers)
+    {
+      const int L = static_cast<int>(layers.size());
+      const int dim = landscape.dim();
+      const int DD = dim * dim;
+      spectra_.resize(L);
+      mean_.resize(L);
+      for (int l = 0; l < L; ++l) {
+        const float* src = landscape[static_cast<Landscape::Layers>(layers[l])].data();
+        double sum = 0.0;
+#       pragma omp parallel for schedule(static) reduction(+:sum)
+        for (int i = 0; i < DD; ++i) sum += src[i];
+        const double mean = sum / DD;
+        auto& F = spectra_[l];
+        F.resize(DD);
+#       pragma omp parallel for schedule(static)
+        for (int i = 0; i < DD; ++i) F[i] = src[i] - mean;
+        fft_->transform(F.data(), false);
+        mean_[l] = mean;
+      }
+
+      // diagonal first: variances are needed to normalize the cross-correlations
+      std::vector<std::pair<int, int>> pairs;
+      for (int a = 0; a < L; ++a) pairs.emplace_back(a, a);
+      for (int a = 0; a < L; ++a) {
+        for (int b = a + 1; b < L; ++b) pairs.emplace_back(a, b);
+      }
+      rows_ = static_cast<int>(pairs.size());
+      records_.assign(static_cast<size_t>(rows_) * R_, 0.f);
+      std::vector<double> var(L);
+      std::vector<double> acc(rmax_ + 1);
+      cross_.resize(DD);
+      for (int p = 0; p < rows_; ++p) {
+        const int a = pairs[p].first;
+        const int b = pairs[p].second;
+        const auto& Fa = spectra_[a];
+        const auto& Fb = spectra_[b];
+#       pragma omp parallel for schedule(static)
+        for (int i = 0; i < DD; ++i) cross_[i] = Fa[i] * std::conj(Fb[i]);
+        fft_->transform(cross_.data(), true);
+        const double norm = 1.0 / (double(DD) * double(DD));   // forward and inverse transform, mean over cells
+        std::fill(acc.begin(), acc.end(), 0.0);
+        for (int i = 0; i < DD; ++i) {
+          if (rbin_[i] >= 0) acc[rbin_[i]] += cross_[i].real() * norm;
+        }
+        const double cov = cross_[0].real() * norm;
+        if (a == b) var[a] = cov;
+        const double ma = mean_[a];
+        const double mb = mean_[b];
+        const double sd2 = std::sqrt(var[a] * var[b]);
+        float* rec = records_.data() + static_cast<size_t>(p) * R_;
+        rec[0] = static_cast<float>(layers[a]);
+        rec[1] = static_cast<float>(layers[b]);
+        rec[2] = static_cast<float>(ma);
+        rec[3] = static_cast<float>(mb);
+        rec[4] = static_cast<float>(cov);
+        rec[5] = (ma * mb > 0.0) ? static_cast<float>(1.0 + (cov - ((a == b) ? ma : 0.0)) / (ma * mb)) : 0.f;
+        for (int r = 0; r <= rmax_; ++r) {
+          rec[6 + r] = (sd2 > 0.0 && rcount_[r]) ? static_cast<float>(acc[r] / (rcount_[r] * sd2)) : 0.f;
+        }
+      }
+    }
+
+    fs::path folder;
+    archive::oarch oa_agents_spa_;
+    archive::method method_;
+    std::unique_ptr<Fft2d> fft_;
+    std::vector<std::vector<Fft2d::complex_t>> spectra_;   // per layer
+    std::vector<Fft2d::complex_t> cross_;
+    std::vector<double> mean_;
+    std::vector<int> rbin_;       // radial bin per displacement, -1 beyond rmax
+    std::vector<int> rcount_;     // displacements per radial bin
+    std::vector<float> records_;  // rows x R
+    int rmax_ = 0;
+    int rows_ = 0;
+    int R_ = 0;
+  };
+
+
+  std::unique_ptr<Observer> CreateSpatialObserver(const std::string& folder)
+  {
+    fs::path path(folder);
+    fs::create_directory(path);
+    return std::unique_ptr<Observer>(new SpatialObserver(path));
+  }
+
+}
@@ -0,0 +1,49 @@
+#ifndef CINE2_SPATIAL_H_INCLUDED
+#define CINE2_SPATIAL_H_INCLUDED
+
+#include <complex>
+#include <vector>
+#include <string>
+#include <cine/observer.h>
+
+
+namespace cine2 {
+
+
+  // Radix-2 FFT on a dim x dim torus, dim shall be a power of two.
+  // Rows and columns are transformed in parallel.
+  class Fft2d
+  {
+  public:
+    using complex_t = std::complex<double>;
+
+    explicit Fft2d(int dim);
+
+    int dim() const { return dim_; }
+
+    // in-place transform, the inverse transform isn't normalized
+    void transform(complex_t* data, bool inverse) const;
+
+  private:
+    void fft1d(complex_t* x, bool inverse) const;
+
+    int dim_;
+    std::vector<int> rev_;            // bit reversal permutation
+    std::vector<complex_t> twiddle_;  // exp(-2 pi i k / dim), k < dim / 2
+  };
+
+
+  // Spatial statistics of spatial.layers, streamed into agents_spa.arc
+  // after every generation.
+  //
+  // One record per layer pair (a <= b, the diagonal first) (float):
+  //   layer_a, layer_b, mean_a, mean_b, cov, patchiness, corr[0..spatial.rmax]
+  // patchiness is Lloyd's index 1 + (var - mean) / mean^2 on the diagonal and
+  // 1 + cov / (mean_a mean_b) otherwise. corr is the radially averaged auto-
+  // or cross-correlation at integer distance r on the torus.
+  std::unique_ptr<class Observer> CreateSpatialObserver(const std::string& folder);
+
+}
+
+
+#endif
@@ -0,0 +1,164 @@
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <stdexcept>
+#include "simulation.h"
+#include "store.h"
+
+#ifdef _WIN32
+#  define NOMINMAX
+#  include <windows.h>
+#endif
+
+
+// Code version, part of the key. Defaults to a hash of the running executable,
+// i.e. every build that changes any part of the code starts with an empty store.
+// Define KLEPTOMOVE_VERSION (e.g. the commit hash) to share the store between
+// builds of the same code.
+
+
+namespace fs = std::filesystem;
+
+
+namespace cine2 {
+
+  namespace store {
+
+    namespace {
+
+      const char* key_file = "run.key";
+
+
+      std::string read_file(const fs::path& file)
+      {
+        std::ifstream is(file, std::ios::in | std::ios::binary);
+        if (!is.is_open()) return {};
+        return std::string((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+      }
+
+
+      std::string version()
+      {
+#ifdef KLEPTOMOVE_VERSION
+        return KLEPTOMOVE_VERSION;
+#else
+#  ifdef _WIN32
+        std::wstring buf(32768, L'\0');
+        const DWORD n = GetModuleFileNameW(nullptr, &buf[0], static_cast<DWORD>(buf.size()));
+        const fs::path exe = (n > 0 && n < buf.size()) ? fs::path(buf.substr(0, n)) : fs::path{};
+#  else
+        const fs::path exe("/proc/self/exe");
+#  endif
+        const std::string bin = exe.empty() ? std::string{} : read_file(exe);
+        if (bin.empty()) throw std::runtime_error("store: can't read the executable, define KLEPTOMOVE_VERSION");
+        return "exe:" + key(bin);
+#endif
+      }
+
+    }
+
+
+    std::string canonical(const Param& param)
+    {
+      std::ostringstream ss;
+      ss << std::setprecision(9);   // round trip float
+      stream_parameter(ss, param, "", "\n", "{", "}");
+      std::istringstream is(ss.str());
+      std::ostringstream os;
+      for (std::string line; std::getline(is, line); ) {
+        if (line.empty() || line.rfind("outdir=", 0) == 0 || line.rfind("store=", 0) == 0 || line.rfind("metrics.", 0) == 0) continue;
+        os << line << '\n';
+      }
+      os << "version=\"" << version() << "\"\n";
+      os << "capacity.image.key=" << key(read_file(fs::path("../settings/") / param.landscape.capacity.image)) << '\n';
+      if (!param.init_agents_ann.empty()) {
+        os << "init_agents_ann.key=" << key(read_file(param.init_agents_ann)) << '\n';
+      }
+      return os.str();
+    }
+
+
+    std::string key(const std::string& canonical)
+    {
+      uint64_t h = 0xcbf29ce484222325ull;   // FNV-1a
+      for (unsigned char c : canonical) {
+        h = (h ^ c) * 0x100000001b3ull;
+      }
+      std::ostringstream os;
+      os << std::hex << std::setw(16) << std::setfill('0') << h;
+      return os.str();
+    }
+
+
+    bool fetch(const fs::path& store, const std::string& key, const std::string& canonical, const fs::path& outdir)
+    {
+      const auto entry = store / key;
+      if (!fs::exists(entry / key_file) || read_file(entry / key_file) != canonical) return false;
+      fs::create_directories(outdir);
+      for (const auto& file : fs::directory_iterator(entry)) {
+        if (file.path().filename() == key_file) continue;
+        fs::copy(file.path(), outdir / file.path().filename(), fs::copy_options::overwrite_existing | fs::copy_options::recursive);
+      }
+      return true;
+    }
+
+  }
+
+
+  class StoreObserver : public Observer
+  {
+  public:
+    StoreObserver(const fs::path& store, const std::string& key, const std::string& canonical, const fs::path& outdir)
+    : Observer(),
+      store_(store), key_(key), canonical_(canonical), outdir_(outdir)
+    {
+    }
+
+    ~StoreObserver() override
+    {
+    }
+
+    // required observer interface
+    bool notify(void* userdata, long long msg) override
+    {
+      using msg_type = Simulation::msg_type;
+
+      if (msg == msg_type::FINISHED) {
+        publish();
+      }
+      return notify_next(userdata, msg);
+    };
+
+  private:
+    // copy into a private folder, then rename: readers never see partial entries
+    void publish()
+    {
+      const auto entry = store_ / key_;
+      if (fs::exists(entry / "run.key")) return;
+      fs::create_directories(store_);
+      const auto tmp = store_ / (key_ + ".partial." + std::to_string(std::hash<std::string>()(outdir_.string())));
+      fs::remove_all(tmp);
+      fs::copy(outdir_, tmp, fs::copy_options::recursive);
+      {
+        std::ofstream os(tmp / "run.key", std::ios::out | std::ios::binary);
+        os << canonical_;
+      }
+      std::error_code ec;
+      fs::rename(tmp, entry, ec);
+      if (ec) fs::remove_all(tmp);    // published concurrently
+    }
+
+    fs::path store_;
+    std::string key_;
+    std::string canonical_;
+    fs::path outdir_;
+  };
+
+
+  std::unique_ptr<Observer> CreateStoreObserver(const std::string& store, const std::string& key, const std::string& canonical, const std::string& outdir)
+  {
+    return std::unique_ptr<Observer>(new StoreObserver(store, key, canonical, outdir));
+  }
+
+}
@@ -0,0 +1,40 @@
+#ifndef CINE2_STORE_H_INCLUDED
+#define CINE2_STORE_H_INCLUDED
+
+#include <string>
+#include <filesystem>
+#include <cine/observer.h>
+#include "parameter.h"
+
+
+namespace cine2 {
+
+  // Content addressed store of completed runs.
+  //
+  // A run is identified by its canonical description: the parameters as
+  // written by stream_parameter (without outdir and store), the contents of
+  // the landscape image and of init_agents_ann, and the code version. Runs without seed are never
+  // identical and aren't stored. store/<key>/ holds a copy of the output
+  // folder and the canonical description (run.key) to rule out collisions.
+  namespace store {
+
+    // throws std::runtime_error if the code version can't be determined
+    std::string canonical(const Param& param);
+
+    // 16 hex digits
+    std::string key(const std::string& canonical);
+
+    // copies a completed run into outdir, returns false if there is none
+    bool fetch(const std::filesystem::path& store, const std::string& key, const std::string& canonical, const std::filesystem::path& outdir);
+
+  }
+
+
+  // Publishes outdir into the store upon msg_type::FINISHED.
+  // Shall be the last observer in the chain.
+  std::unique_ptr<class Observer> CreateStoreObserver(const std::string& store, const std::string& key, const std::string& canonical, const std::string& outdir);
+
+}
+
+
+#endif
@@ -0,0 +1,248 @@
+#include <omp.h>
+#include <filesystem>
+#include "simulation.h"
+#include "strategy.h"
+#include "archive.hpp"
+#include "rnd.hpp"
+
+
+namespace fs = std::filesystem;
+
+
+namespace cine2 {
+
+
+  namespace {
+
+    enum Strategy : int {
+      forager = 0,
+      klept,
+      conditional
+    };
+
+
+    // returns index of the nearest centroid (squared euclidian distance)
+    int nearest(const float* __restrict x, const float* __restrict centroids, int k, int n)
+    {
+      int best = 0;
+      float best_d2 = std::numeric_limits<float>::max();
+      for (int c = 0; c < k; ++c, centroids += n) {
+        float d2 = 0.f;
+        for (int w = 0; w < n; ++w) {
+          const float d = x[w] - centroids[w];
+          d2 += d * d;
+        }
+        if (d2 < best_d2) { best_d2 = d2; best = c; }
+      }
+      return best;
+    }
+
+  }
+
+
+  class StrategyObserver : public Observer
+  {
+  public:
+    explicit StrategyObserver(const fs::path& path)
+    : Observer(),
+      folder(path),
+      reng_(rndutils::make_random_engine())
+    {
+    }
+
+    ~StrategyObserver() override
+    {
+    }
+
+    // required observer interface
+    bool notify(void* userdata, long long msg) override
+    {
+      auto sim = reinterpret_cast<const Simulation*>(userdata);
+      using msg_type = Simulation::msg_type;
+
+      switch (msg) {
+        case msg_type::INITIALIZED:
+          if (sim->param().seed) {
+            reng_ = rndutils::make_random_engine<rndutils::default_engine>(rnd::splitmix64(sim->param().seed ^ 0x7374726174656779ull));
+          }
+          oa_agents_str_.open(folder / "agents_str.arc", "strategy");
+          method_ = archive::parse_method(sim->param().output.codec);
+          break;
+        case msg_type::GENERATION:
+          classify(sim);
+          cluster(sim->agents(), sim->param().strategy.k, sim->param().strategy.batch, sim->param().strategy.iter);
+          stream_generation(oa_agents_str_);
+          break;
+        case msg_type::FINISHED:
+          oa_agents_str_.close();
+          break;
+      }
+      return notify_next(userdata, msg);
+    };
+
+  private:
+    // Sign-pattern classification and movement preference slopes.
+    // The strategy output is probed on a grid spanning the observed input range
+    // (at zero input for obligate strategies), the preference output at the
+    // lower and upper end of every input with the remaining inputs at their mean.
+    void classify(const Simulation* sim)
+    {
+      const auto& iparam = sim->param().agents;
+      const auto& ann = *sim->agents().ann;
+      const auto& input = sim->analysis().agents_input();
+      const int N = ann.N();
+      const int I = ann.input_size();
+      const int O = ann.output_size();
+      I_ = I;
+
+      std::vector<float> lo(I), mid(I), hi(I);
+      for (int j = 0; j < I; ++j) {
+        lo[j] = iparam.input_mask[j] * input[j].back().mini;
+        mid[j] = iparam.input_mask[j] * input[j].back().mean;
+        hi[j] = iparam.input_mask[j] * input[j].back().maxi;
+      }
+      grid_.clear();
+      int P = 1;
+      if (iparam.obligate) {
+        grid_.assign(I, 0.f);
+      }
+      else {
+        for (int j = 0; j < I; ++j) P *= 3;
+        for (int p = 0; p < P; ++p) {
+          for (int j = 0, q = p; j < I; ++j, q /= 3) {
+            grid_.push_back((q % 3 == 0) ? lo[j] : (q % 3 == 1) ? mid[j] : hi[j]);
+          }
+        }
+      }
+      for (int j = 0; j < I; ++j) {
+        for (int e = 0; e < 2; ++e) {
+          for (int m = 0; m < I; ++m) {
+            grid_.push_back(m != j ? mid[m] : (e ? hi[m] : lo[m]));
+          }
+        }
+      }
+      const int n = static_cast<int>(grid_.size()) / I;
+
+      strategy_.resize(N);
+      pref_.resize(static_cast<size_t>(N) * I);
+#     pragma omp parallel
+      {
+        std::vector<float> out(static_cast<size_t>(n) * O);
+#       pragma omp for schedule(static)
+        for (int i = 0; i < N; ++i) {
+          ann.evaluate(i, grid_.data(), n, out.data());
+          int pos = 0;
+          for (int p = 0; p < P; ++p) pos += (out[p * O + 1] >= 0.f) ? 1 : 0;
+          strategy_[i] = (iparam.forage || pos == P) ? forager : (pos == 0) ? klept : conditional;
+          for (int j = 0; j < I; ++j) {
+            const float range = hi[j] - lo[j];
+            const float dpref = out[(P + 2 * j + 1) * O] - out[(P + 2 * j) * O];
+            pref_[static_cast<size_t>(i) * I + j] = (range > 0.f) ? dpref / range : 0.f;
+          }
+        }
+      }
+    }
+
+
+    // Mini-batch k-means over the weight vectors, warm-started from the
+    // centroids of the previous generation.
+    void cluster(const Population& Pop, int k, int batch, int iter)
+    {
+      const auto& ann = *Pop.ann;
+      const int N = ann.N();
+      const int W = ann.state_size();
+      k = std::min(k, N);
+      batch = std::min(batch, N);
+      if (centroids_.size() != static_cast<size_t>(k) * W) {
+        centroids_.resize(static_cast<size_t>(k) * W);
+        std::vector<int> seeds(N);
+        std::iota(seeds.begin(), seeds.end(), 0);
+        for (int c = 0; c < k; ++c) {
+          std::swap(seeds[c], seeds[std::uniform_int_distribution<int>(c, N - 1)(reng_)]);
+          std::copy(ann[seeds[c]], ann[seeds[c]] + W, centroids_.begin() + c * W);
+        }
+      }
+
+      std::vector<int> counts(k, 0);
+      std::vector<int> sample(batch);
+      std::vector<int> label(batch);
+      auto rind = std::uniform_int_distribution<int>(0, N - 1);
+      for (int it = 0; it < iter; ++it) {
+        for (auto& s : sample) s = rind(reng_);
+#       pragma omp parallel for schedule(static)
+        for (int b = 0; b < batch; ++b) {
+          label[b] = nearest(ann[sample[b]], centroids_.data(), k, W);
+        }
+        for (int b = 0; b < batch; ++b) {
+          float* __restrict c = centroids_.data() + label[b] * W;
+          const float* __restrict x = ann[sample[b]];
+          const float eta = 1.f / ++counts[label[b]];
+          for (int w = 0; w < W; ++w) c[w] += eta * (x[w] - c[w]);
+        }
+      }
+
+      // final assignment and per-cluster reduction
+      const int I = I_;
+      const int R = 4 + I + W;
+      records_.assign(static_cast<size_t>(k) * R, 0.f);
+#     pragma omp parallel
+      {
+        std::vector<double> acc(static_cast<size_t>(k) * R, 0.0);
+#       pragma omp for schedule(static)
+        for (int i = 0; i < N; ++i) {
+          const float* x = ann[i];
+          double* a = acc.data() + nearest(x, centroids_.data(), k, W) * R;
+          a[0] += 1.0;
+          a[1 + strategy_[i]] += 1.0;
+          for (int j = 0; j < I; ++j) a[4 + j] += pref_[static_cast<size_t>(i) * I + j];
+          for (int w = 0; w < W; ++w) a[4 + I + w] += x[w];
+        }
+#       pragma omp critical
+        {
+          for (size_t r = 0; r < acc.size(); ++r) records_[r] += static_cast<float>(acc[r]);
+        }
+      }
+      for (int c = 0; c < k; ++c) {
+        float* rec = records_.data() + c * R;
+        const float size = rec[0];
+        if (size > 0.f) {
+          for (int r = 1; r < R; ++r) rec[r] /= size;
+          std::copy(rec + 4 + I, rec + R, centroids_.begin() + c * W);
+        }
+        else {
+          std::copy(centroids_.begin() + c * W, centroids_.begin() + (c + 1) * W, rec + 4 + I);
+        }
+      }
+      k_ = k;
+      R_ = R;
+    }
+
+
+    void stream_generation(archive::oarch& oa_str)
+    {
+      oa_str.insert(archive::compress(records_.data(), k_, R_ * sizeof(float), 0, method_));
+    }
+
+    fs::path folder;
+    archive::oarch oa_agents_str_;
+    archive::method method_;
+    rndutils::default_engine reng_;   // own stream, doesn't disturb the simulation streams
+    std::vector<float> grid_;         // probe inputs
+    std::vector<int> strategy_;       // per individual
+    std::vector<float> pref_;         // per individual preference slopes
+    std::vector<float> centroids_;    // k x state_size
+    std::vector<float> records_;      // k x R
+    int I_ = 0;
+    int k_ = 0;
+    int R_ = 0;
+  };
+
+
+  std::unique_ptr<Observer> CreateStrategyObserver(const std::string& folder)
+  {
+    fs::path path(folder);
+    fs::create_directory(path);
+    return std::unique_ptr<Observer>(new StrategyObserver(path));
+  }
+
+}
@@ -0,0 +1,20 @@
+#ifndef CINE2_STRATEGY_H_INCLUDED
+#define CINE2_STRATEGY_H_INCLUDED
+
+#include <string>
+#include <cine/observer.h>
+
+
+namespace cine2 {
+
+  // Clusters the genomes of every generation into strategies and
+  // streams the cluster summaries into agents_str.arc.
+  //
+  // Record per cluster (float):
+  //   size, forager, klept, conditional, pref_slope[input_size], centroid[state_size]
+  std::unique_ptr<class Observer> CreateStrategyObserver(const std::string& folder);
+
+}
+
+
+#endif
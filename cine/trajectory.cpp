@@ -0,0 +1,160 @@
+#include <fstream>
+#include <filesystem>
+#include "simulation.h"
+#include "trajectory.h"
+
+
+namespace fs = std::filesystem;
+
+
+namespace cine2 {
+
+
+  void Trajectories::reset(int N, int k, int capacity, const std::array<int, 4>& roi, uint64_t seed)
+  {
+    if (seed) reng_ = rndutils::make_random_engine<rndutils::default_engine>(rnd::splitmix64(seed ^ 0x7472616a65637431ull));
+    k_ = k;
+    capacity_ = capacity;
+    roi_ = roi;
+    tracked_.clear();
+    slot_.assign((k > 0) ? N : 0, -1);
+    written_ = 0;
+  }
+
+
+  void Trajectories::select(int g, const std::vector<Individual>& pop)
+  {
+    g_ = g;
+    written_ = 0;
+    for (int idx : tracked_) slot_[idx] = -1;
+    tracked_.clear();
+    if (k_ == 0) return;
+
+    // reservoir sampling (algorithm R) over the eligible agents
+    const bool roi = (roi_[2] > roi_[0]) && (roi_[3] > roi_[1]);
+    const int N = static_cast<int>(pop.size());
+    int seen = 0;
+    for (int i = 0; i < N; ++i) {
+      const auto& ind = pop[i];
+      if (!ind.alive()) continue;
+      if (roi && (ind.pos.x < roi_[0] || ind.pos.x >= roi_[2] || ind.pos.y < roi_[1] || ind.pos.y >= roi_[3])) continue;
+      if (seen < k_) {
+        tracked_.push_back(i);
+      }
+      else {
+        const int j = std::uniform_int_distribution<int>(0, seen)(reng_);
+        if (j < k_) tracked_[j] = i;
+      }
+      ++seen;
+    }
+    std::sort(tracked_.begin(), tracked_.end());
+    const int K = static_cast<int>(tracked_.size());
+    for (int s = 0; s < K; ++s) slot_[tracked_[s]] = s;
+    ring_.resize(static_cast<size_t>(K) * capacity_);
+    decision_.assign(2 * K, std::numeric_limits<float>::quiet_NaN());
+  }
+
+
+  void Trajectories::record(const std::vector<Individual>& pop)
+  {
+    const uint64_t n = written_++;
+    const int K = static_cast<int>(tracked_.size());
+    for (int s = 0; s < K; ++s) {
+      const auto& ind = pop[tracked_[s]];
+      const unsigned char state = (ind.alive() ? 1 : 0) | (ind.handling ? 2 : 0) | (ind.foraging ? 4 : 0) | (ind.just_lost ? 8 : 0);
+      ring_[static_cast<size_t>(s) * capacity_ + n % capacity_] = { ind.pos, state, ind.food, decision_[2 * s], decision_[2 * s + 1] };
+      decision_[2 * s] = decision_[2 * s + 1] = std::numeric_limits<float>::quiet_NaN();
+    }
+  }
+
+
+  class TrajectoryObserver : public Observer
+  {
+  public:
+    explicit TrajectoryObserver(const fs::path& path)
+    : Observer(),
+      folder(path)
+    {
+    }
+
+    ~TrajectoryObserver() override
+    {
+    }
+
+    // required observer interface
+    bool notify(void* userdata, long long msg) override
+    {
+      auto sim = reinterpret_cast<const Simulation*>(userdata);
+      using msg_type = Simulation::msg_type;
+
+      switch (msg) {
+        case msg_type::INITIALIZED: {
+          fb_.open(folder / "agents_trj.bin", std::ios::out | std::ios::binary);
+          if (!fb_.is_open()) throw std::runtime_error("can't create agents_trj.bin");
+          const uint32_t header[2] = { trajectory_log::magic, trajectory_log::version };
+          fb_.sputn((const char*)header, sizeof(header));
+          break;
+        }
+        case msg_type::NEW_GENERATION:
+          flushed_ = 0;
+          break;
+        case msg_type::POST_TIMESTEP: {
+          const auto& tracks = sim->trajectories();
+          if (tracks.written() - flushed_ == static_cast<uint64_t>(tracks.capacity())) flush(tracks);
+          break;
+        }
+        case msg_type::GENERATION:
+          flush(sim->trajectories());
+          break;
+        case msg_type::FINISHED:
+          fb_.close();
+          break;
+      }
+      return notify_next(userdata, msg);
+    };
+
+  private:
+    // writes the samples [flushed_, written) of all tracked agents
+    void flush(const Trajectories& tracks)
+    {
+      using namespace conflict_log;   // varint coding
+      const uint64_t n = tracks.written() - flushed_;
+      if (!tracks.active() || n == 0) return;
+      const auto& tracked = tracks.tracked();
+      buf_.clear();
+      put_varint(buf_, uint64_t(tracks.generation()));
+      put_varint(buf_, flushed_);
+      put_varint(buf_, n);
+      put_varint(buf_, tracked.size());
+      for (int s = 0; s < static_cast<int>(tracked.size()); ++s) {
+        put_varint(buf_, uint64_t(tracked[s]));
+        Coordinate prev(0, 0);
+        for (uint64_t i = flushed_; i < tracks.written(); ++i) {
+          const auto& smp = tracks.sample(s, i);
+          put_varint(buf_, zigzag(smp.pos.x - prev.x));
+          put_varint(buf_, zigzag(smp.pos.y - prev.y));
+          buf_.push_back(static_cast<char>(smp.state));
+          const float f[3] = { smp.food, smp.eval, smp.eval2 };
+          buf_.insert(buf_.end(), (const char*)f, (const char*)f + sizeof(f));
+          prev = smp.pos;
+        }
+      }
+      fb_.sputn(buf_.data(), buf_.size());
+      flushed_ = tracks.written();
+    }
+
+    fs::path folder;
+    std::filebuf fb_;
+    std::vector<char> buf_;
+    uint64_t flushed_ = 0;
+  };
+
+
+  std::unique_ptr<Observer> CreateTrajectoryObserver(const std::string& folder)
+  {
+    fs::path path(folder);
+    fs::create_directory(path);
+    return std::unique_ptr<Observer>(new TrajectoryObserver(path));
+  }
+
+}
@@ -0,0 +1,99 @@
+#ifndef CINE2_TRAJECTORY_H_INCLUDED
+#define CINE2_TRAJECTORY_H_INCLUDED
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <string>
+#include <limits>
+#include "individuals.h"
+#include "rnd.hpp"
+#include <cine/observer.h>
+
+
+namespace cine2 {
+
+
+  struct TrackSample
+  {
+    Coordinate pos;
+    unsigned char state;    // bit 0: alive, 1: handling, 2: foraging, 3: just lost
+    float food;
+    float eval;             // preference of the chosen cell, NaN if the agent didn't move
+    float eval2;            // strategy output at the chosen cell, NaN if the agent didn't move
+  };
+
+
+  // Movement tracks of a sampled subset of the population.
+  //
+  // k agents are selected at the start of every generation, by reservoir
+  // sampling either from the whole population or from the agents inside a
+  // region of interest. Each tracked agent owns a ring buffer of 'capacity'
+  // samples, one sample per timestep. Memory is k * capacity samples,
+  // independent of T. Untracked agents cost a single slot lookup in move.
+  class Trajectories
+  {
+  public:
+    // k: tracked agents (0: off), capacity: ring size, roi: {x0, y0, x1, y1}, empty: everywhere
+    // seed: reproducible selection if non-zero
+    void reset(int N, int k, int capacity, const std::array<int, 4>& roi, uint64_t seed);
+
+    bool active() const { return !tracked_.empty(); }
+
+    // selects the tracked agents of generation g
+    void select(int g, const std::vector<Individual>& pop);
+
+    // ring slot of agent idx, -1 if not tracked
+    int slot(int idx) const { return slot_[idx]; }
+
+    // decision outputs of timestep t, set from move for tracked agents only
+    void decide(int slot, float eval, float eval2)
+    {
+      decision_[2 * slot] = eval;
+      decision_[2 * slot + 1] = eval2;
+    }
+
+    // appends one sample per tracked agent, called once per timestep
+    void record(const std::vector<Individual>& pop);
+
+    int generation() const { return g_; }
+    int capacity() const { return capacity_; }
+    uint64_t written() const { return written_; }         // samples per agent in this generation, sample n: timestep n
+    const std::vector<int>& tracked() const { return tracked_; }   // agent indices, ascending
+    const TrackSample& sample(int slot, uint64_t n) const { return ring_[static_cast<size_t>(slot) * capacity_ + n % capacity_]; }
+
+  private:
+    int k_ = 0;
+    int capacity_ = 0;
+    std::array<int, 4> roi_ = { { 0, 0, 0, 0 } };
+    uint64_t written_ = 0;
+    int g_ = -1;
+    std::vector<int> tracked_;
+    std::vector<int> slot_;
+    std::vector<float> decision_;
+    std::vector<TrackSample> ring_;     // tracked x capacity
+    rndutils::default_engine reng_ = rndutils::make_random_engine();   // own stream, doesn't disturb the simulation streams
+  };
+
+
+  namespace trajectory_log {
+
+    // file layout:
+    //   magic 'KTRJ', uint32 version
+    //   blocks: varint(g), varint(t0), varint(n samples), varint(k agents)
+    //           k x { varint(idx), n x { varint(zigzag(dx)), varint(zigzag(dy)), uint8 state, float food, eval, eval2 } }
+    //   dx, dy are the differences to the previous sample of the agent within the block.
+    const uint32_t magic = 0x4a52544b;    // little endian ascii: 'KTRJ'
+    const uint32_t version = 1;
+
+  }
+
+
+  // Streams the tracks recorded by Simulation::trajectories() into agents_trj.bin.
+  // Flushes whenever the ring buffers are full and at the end of every generation.
+  std::unique_ptr<class Observer> CreateTrajectoryObserver(const std::string& folder);
+
+}
+
+
+#endif
@@ -1,6 +1,10 @@
 #include <iostream>
+#include <cstring>
+#include <iterator>
 #include <cine/cmd_line.h>
 #include <cine/archive.hpp>
+#include <cine/conflict_log.h>
+#include <cine/trajectory.h>
 
 
 using namespace archive;
@@ -26,6 +30,67 @@ void convert(const fs::path& tmp, const fs::path& arc, int G)
 }
 
 
+// conflicts.bin -> int32 rows {g, t, cell, attacker, victim, outcome}
+void convert_conflicts(const fs::path& tmp, const fs::path& bin)
+{
+  std::ifstream is(bin, std::ios::in | std::ios::binary);
+  if (!is.is_open()) throw std::runtime_error("can't open conflicts.bin");
+  std::vector<char> buf((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+  uint32_t header[2] = { 0, 0 };
+  if (buf.size() >= sizeof(header)) std::memcpy(header, buf.data(), sizeof(header));
+  if (header[0] != cine2::conflict_log::magic || header[1] != cine2::conflict_log::version) {
+    throw std::runtime_error("conflicts.bin: invalid header");
+  }
+  auto rows = cine2::conflict_log::decode(buf.data() + sizeof(header), buf.data() + buf.size());
+  std::filebuf fb;
+  fb.open(tmp, std::ios::out | std::ios::binary);
+  if (!fb.is_open()) throw std::runtime_error("can't create output file");
+  fb.sputn((char*)rows.data(), rows.size() * sizeof(rows[0]));
+}
+
+
+// agents_trj.bin -> double rows {g, t, idx, x, y, state, food, eval, eval2}
+void convert_trajectories(const fs::path& tmp, const fs::path& bin)
+{
+  using namespace cine2::conflict_log;   // varint coding
+  std::ifstream is(bin, std::ios::in | std::ios::binary);
+  if (!is.is_open()) throw std::runtime_error("can't open agents_trj.bin");
+  std::vector<char> buf((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+  uint32_t header[2] = { 0, 0 };
+  if (buf.size() >= sizeof(header)) std::memcpy(header, buf.data(), sizeof(header));
+  if (header[0] != cine2::trajectory_log::magic || header[1] != cine2::trajectory_log::version) {
+    throw std::runtime_error("agents_trj.bin: invalid header");
+  }
+  std::vector<double> rows;
+  const char* p = buf.data() + sizeof(header);
+  const char* end = buf.data() + buf.size();
+  while (p != end) {
+    const double g = static_cast<double>(get_varint(p, end));
+    const uint64_t t0 = get_varint(p, end);
+    const uint64_t n = get_varint(p, end);
+    const uint64_t k = get_varint(p, end);
+    for (uint64_t a = 0; a < k; ++a) {
+      const double idx = static_cast<double>(get_varint(p, end));
+      int64_t x = 0, y = 0;
+      for (uint64_t i = 0; i < n; ++i) {
+        x += unzigzag(get_varint(p, end));
+        y += unzigzag(get_varint(p, end));
+        float f[3];
+        if (end - p < static_cast<ptrdiff_t>(1 + sizeof(f))) throw std::runtime_error("agents_trj.bin: truncated");
+        const double state = static_cast<unsigned char>(*p++);
+        std::memcpy(f, p, sizeof(f));
+        p += sizeof(f);
+        rows.insert(rows.end(), { g, double(t0 + i), idx, double(x), double(y), state, f[0], f[1], f[2] });
+      }
+    }
+  }
+  std::filebuf fb;
+  fb.open(tmp, std::ios::out | std::ios::binary);
+  if (!fb.is_open()) throw std::runtime_error("can't create output file");
+  fb.sputn((char*)rows.data(), rows.size() * sizeof(double));
+}
+
+
 int main(int argc, const char** argv)
 {
   try {
@@ -35,15 +100,29 @@ int main(int argc, const char** argv)
       fs::remove_all(dir / "tmp");
       return 0;
     }
+    if (clp.flag("--conflicts")) {
+      fs::create_directory(dir / "tmp");
+      convert_conflicts(dir / "tmp" / "conflicts.tmp", dir / "conflicts.bin");
+      return 0;
+    }
+    if (clp.flag("--trajectories")) {
+      fs::create_directory(dir / "tmp");
+      convert_trajectories(dir / "tmp" / "trajectories.tmp", dir / "agents_trj.bin");
+      return 0;
+    }
     auto G = clp.required<int>("G");
     auto what = clp.required<std::string>("what");
     auto tmp = dir / "tmp";
     fs::create_directory(tmp);
-    convert<float, double>(tmp / (what + "_fit.tmp"), dir / (what + "_fit.arc"), G);
-    convert<float, double>(tmp / (what + "_foa.tmp"), dir / (what + "_foa.arc"), G);
-    convert<float, double>(tmp / (what + "_han.tmp"), dir / (what + "_han.arc"), G);
-    convert<int, int>(tmp / (what + "_anc.tmp"), dir / (what + "_anc.arc"), G);
-    convert<float, double>(tmp / (what + "_ann.tmp"), dir / (what + "_ann.arc"), G);
+    // archives are optional: output.mode=summary writes _dst instead of the per-agent arrays
+    for (const char* ext : { "_fit", "_foa", "_han", "_ann", "_str", "_dst", "_spa" }) {
+      if (fs::exists(dir / (what + ext + ".arc"))) {
+        convert<float, double>(tmp / (what + ext + ".tmp"), dir / (what + ext + ".arc"), G);
+      }
+    }
+    if (fs::exists(dir / (what + "_anc.arc"))) {
+      convert<int, int>(tmp / (what + "_anc.tmp"), dir / (what + "_anc.arc"), G);
+    }
     return 0;
   }
   catch (cmd::parse_error& err) {
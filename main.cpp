@@ -4,6 +4,12 @@
 #include "cine/simulation.h"
 #include "cine/cmd_line.h"
 #include "cine/cnObserver.h"
+#include "cine/strategy.h"
+#include "cine/conflict_log.h"
+#include "cine/trajectory.h"
+#include "cine/spatial.h"
+#include "cine/store.h"
+#include "cine/metrics.h"
 #include "cinema/AppWin.h"
 #include <cine/archive.hpp>
 
@@ -31,6 +37,16 @@ int main(int argc, const char** argv)
       }
       return 1;
     }
+    // completed identical run?
+    std::string run_canonical, run_key;
+    if (!param.store.empty()) {
+      run_canonical = store::canonical(param);
+      run_key = store::key(run_canonical);
+      if (!gui && !param.outdir.empty() && store::fetch(param.store, run_key, run_canonical, param.outdir)) {
+        std::cout << "\nIdentical run " << run_key << " copied from " << param.store << "\nRegards.\n";
+        return 0;
+      }
+    }
     // create simulation host
     std::unique_ptr<SimulationHost> host;
     host.reset(gui ? new cinema::AppWin() 
@@ -41,8 +57,20 @@ int main(int argc, const char** argv)
     auto headObserver = std::unique_ptr<Observer>(new Observer());    // dummy observer for chaining
     std::unique_ptr<Observer> cmdline_observer = quiet ? nullptr : CreateSimpleObserver();
     std::unique_ptr<Observer> cn_observer = param.outdir.empty() ? nullptr : CreateCnObserver(param.outdir);
+    std::unique_ptr<Observer> str_observer = (param.outdir.empty() || param.strategy.k <= 0) ? nullptr : CreateStrategyObserver(param.outdir);
+    std::unique_ptr<Observer> cl_observer = (param.outdir.empty() || !param.conflicts.log) ? nullptr : CreateConflictLogObserver(param.outdir);
+    std::unique_ptr<Observer> trj_observer = (param.outdir.empty() || param.trajectory.k == 0) ? nullptr : CreateTrajectoryObserver(param.outdir);
+    std::unique_ptr<Observer> spa_observer = (param.outdir.empty() || param.spatial.rmax <= 0) ? nullptr : CreateSpatialObserver(param.outdir);
+    std::unique_ptr<Observer> metrics_observer = param.metrics.file.empty() ? nullptr : CreateMetricsObserver(param.metrics.file, param.metrics.interval, param.outdir);
+    std::unique_ptr<Observer> store_observer = (param.outdir.empty() || param.store.empty()) ? nullptr : CreateStoreObserver(param.store, run_key, run_canonical, param.outdir);
     headObserver->chain_back(cmdline_observer.get());
     headObserver->chain_back(cn_observer.get());
+    headObserver->chain_back(str_observer.get());
+    headObserver->chain_back(cl_observer.get());
+    headObserver->chain_back(trj_observer.get());
+    headObserver->chain_back(spa_observer.get());
+    headObserver->chain_back(metrics_observer.get());
+    headObserver->chain_back(store_observer.get());   // last: all output written
     if (!host->run(headObserver.get(), param)) {
       std::cerr << "\nSimulation terminated.\nBailing out.\n";
     }